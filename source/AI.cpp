@@ -238,6 +238,39 @@ namespace {
 	// The health remaining before becoming disabled, at which fighters and
 	// other ships consider retreating from battle.
 	const double RETREAT_HEALTH = .25;
+	// Ships that the player cannot see only make decisions once in this many
+	// steps. This must be a power of two.
+	const int COARSE_INTERVAL = 4;
+	
+	// Check if the given ship is far enough from the player that it does not
+	// need to think every step. Ships in the player's system, the player's own
+	// ships, and anything traveling with them or toward the player's system
+	// are always simulated in full.
+	bool IsCoarse(const Ship &ship, const System *playerSystem)
+	{
+		if(ship.GetSystem() == playerSystem || ship.IsYours() || ship.GetTargetSystem() == playerSystem)
+			return false;
+		
+		shared_ptr<const Ship> parent = ship.GetParent();
+		return !(parent && parent->IsYours());
+	}
+	
+	// In between decisions, keep following the previous commands, including
+	// the turn that the last decision chose. Stop thrusting if that would
+	// reverse the ship's motion instead of just slowing it down.
+	void KeepCourse(Ship &ship, double turn)
+	{
+		Command command = ship.Commands();
+		command.SetTurn(turn);
+		
+		double speed = ship.Velocity().Dot(ship.Facing().Unit());
+		double acceleration = ship.Acceleration();
+		if(speed < 0. && speed > -acceleration)
+			command.Clear(Command::FORWARD | Command::AFTERBURNER);
+		if(speed > 0. && speed < acceleration)
+			command.Clear(Command::BACK);
+		ship.SetCommands(command);
+	}
 }
 
 
@@ -406,6 +439,7 @@ void AI::Clean()
 	playerActions.clear();
 	swarmCount.clear();
 	fenceCount.clear();
+	coarseTurns.clear();
 	miningAngle.clear();
 	miningTime.clear();
 	appeasmentThreshold.clear();
@@ -459,6 +493,12 @@ void AI::Step(const PlayerInfo &player)
 	const int maxMinerCount = minables.empty() ? 0 : 9;
 	bool opportunisticEscorts = !Preferences::Has("Turrets focus fire");
 	bool fightersRetreat = Preferences::Has("Damaged fighters retreat");
+	int coarseTurn = 0;
+	// Ships in other systems that make a decision in this step, and the turn
+	// that each of the others is keeping. This is rebuilt every step so that
+	// ships that have died or left are dropped from it.
+	vector<const Ship *> deciding;
+	map<const Ship *, double> keptTurns;
 	for(const auto &it : ships)
 	{
 		// Skip any carried fighters or drones that are somehow in the list.
@@ -471,6 +511,24 @@ void AI::Step(const PlayerInfo &player)
 			continue;
 		}
 		
+		// Ships in other systems take turns deciding what to do, so that only a
+		// few of them plan their routes in any given step. In between, they keep
+		// following their previous commands, including the last turn that they
+		// chose, so they still turn and move at their full speed.
+		if(IsCoarse(*it, playerSystem))
+		{
+			coarseTurn = (coarseTurn + 1) & (COARSE_INTERVAL - 1);
+			if(coarseTurn != (step & (COARSE_INTERVAL - 1)))
+			{
+				auto tit = coarseTurns.find(it.get());
+				double turn = (tit == coarseTurns.end() ? 0. : tit->second);
+				KeepCourse(*it, turn);
+				keptTurns[it.get()] = turn;
+				continue;
+			}
+			deciding.push_back(it.get());
+		}
+		
 		const Government *gov = it->GetGovernment();
 		const Personality &personality = it->GetPersonality();
 		double health = .5 * it->Shields() + it->Hull();
@@ -857,6 +915,12 @@ void AI::Step(const PlayerInfo &player)
 		
 		it->SetCommands(command);
 	}
+	
+	// Remember the turn that each decision actually produced, whichever way
+	// the ship arrived at it.
+	for(const Ship *ship : deciding)
+		keptTurns[ship] = ship->Commands().Turn();
+	coarseTurns.swap(keptTurns);
 }
 
 
@@ -214,6 +214,8 @@ private:
 	std::map<const Ship *, std::weak_ptr<Ship>> helperList;
 	std::map<const Ship *, int> swarmCount;
 	std::map<const Ship *, int> fenceCount;
+	// The turn that each ship in another system chose at its last decision.
+	std::map<const Ship *, double> coarseTurns;
 	std::map<const Ship *, Angle> miningAngle;
 	std::map<const Ship *, int> miningTime;
 	std::map<const Ship *, double> appeasmentThreshold;
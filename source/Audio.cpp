@@ -15,6 +15,7 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #include "Files.h"
 #include "Music.h"
 #include "Point.h"
+#include "Profiler.h"
 #include "Random.h"
 #include "Sound.h"
 
@@ -27,7 +28,10 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #endif
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <cstddef>
+#include <deque>
 #include <map>
 #include <mutex>
 #include <set>
@@ -67,10 +71,61 @@ namespace {
 		unsigned source = 0;
 	};
 	
+	// Fixed-size ring of sound requests that may be added to by any number of
+	// threads without locking, but only emptied by the main thread. Each slot
+	// has a sequence number that tells whether it is ready to be written to or
+	// read from. If the ring fills up, new requests are simply dropped.
+	class RequestRing {
+	public:
+		RequestRing();
+		
+		// Add a request. This returns false if there is no room for it.
+		bool Push(const Sound *sound, const Point &position);
+		// Remove the oldest request. This returns false if the ring is empty.
+		bool Pop(const Sound *&sound, Point &position);
+		
+	private:
+		// This must be a power of two.
+		static const size_t SIZE = 4096;
+		class Slot {
+		public:
+			atomic<size_t> sequence;
+			const Sound *sound = nullptr;
+			Point position;
+		};
+		
+		Slot slots[SIZE];
+		// The next slot to be written and the next slot to be read.
+		atomic<size_t> tail;
+		size_t head = 0;
+	};
+	
 	// Thread entry point for loading the sound files.
 	void Load();
 	
 	
+	// Entry points for the ALC_SOFT_loopback extension, which provides a device
+	// that mixes the audio into a buffer instead of sending it to the speakers.
+	typedef ALCdevice *(ALC_APIENTRY *LoopbackOpenDevice)(const ALCchar *name);
+	typedef void (ALC_APIENTRY *RenderSamples)(ALCdevice *device, ALCvoid *buffer, ALCsizei samples);
+	const ALCint ALC_FORMAT_CHANNELS_SOFT = 0x1990;
+	const ALCint ALC_FORMAT_TYPE_SOFT = 0x1991;
+	const ALCint ALC_STEREO_SOFT = 0x1501;
+	const ALCint ALC_SHORT_SOFT = 0x1402;
+	
+	// Open a loopback device, if that extension is available.
+	ALCdevice *OpenLoopback();
+	
+	
+	// Sounds that are played by name from the engine or the user interface,
+	// rather than being attached to an outfit or effect. These are loaded before
+	// the game starts; all other sounds load in the background afterwards.
+	const set<string> CRITICAL = {
+		"alarm", "fail", "landing", "takeoff", "scan", "warder",
+		"hyperdrive", "hyperdrive in", "hyperdrive out",
+		"jump drive", "jump in", "jump out"};
+	
+	
 	// Mutex to make sure different threads don't modify the audio at the same time.
 	mutex audioMutex;
 	
@@ -80,11 +135,24 @@ namespace {
 	bool isInitialized = false;
 	double volume = .125;
 	
-	// This queue keeps track of sounds that have been requested to play. Each
-	// added sound is "deferred" until the next audio position update to make
-	// sure that all sounds from a given frame start at the same time.
+	// If audio is going to a loopback device, each step must mix one frame's
+	// worth of samples into this buffer.
+	RenderSamples renderSamples = nullptr;
+	const ALCsizei LOOPBACK_SAMPLES = 44100 / 60;
+	vector<int16_t> loopbackBuffer;
+	
+	// Statistics for the frame in progress and the most recent complete frame.
+	// Requests and dropped requests may come from any thread.
+	atomic<int> requests(0);
+	atomic<int> dropped(0);
+	Audio::Statistics current;
+	Audio::Statistics previous;
+	
+	// This queue keeps track of sounds that have been requested to play. Sounds
+	// from other threads are "deferred" until the next audio position update to
+	// make sure that all sounds from a given frame start at the same time.
 	map<const Sound *, QueueEntry> queue;
-	map<const Sound *, QueueEntry> deferred;
+	RequestRing deferred;
 	thread::id mainThreadID;
 	
 	// Sound resources that have been loaded from files.
@@ -96,9 +164,13 @@ namespace {
 	vector<unsigned> endingSources;
 	unsigned maxSources = 255;
 	
-	// Queue and thread for loading sound files in the background.
-	map<string, string> loadQueue;
-	thread loadThread;
+	// Queue of (name, path) pairs and threads for loading sound files in the
+	// background. Critical sounds are at the front of the queue. Progress() only
+	// counts the critical sounds that have not been loaded yet.
+	deque<pair<string, string>> loadQueue;
+	vector<thread> loadThreads;
+	size_t criticalTotal = 0;
+	size_t criticalRemaining = 0;
 	
 	// The current position of the "listener," i.e. the center of the screen.
 	Point listener;
@@ -111,20 +183,32 @@ namespace {
 	shared_ptr<Music> previousTrack;
 	int musicFade = 0;
 	vector<int16_t> fadeBuffer;
+	// Number of times the music source stopped because it ran out of buffers.
+	int musicStops = 0;
 }
 
 
 
-// Begin loading sounds (in a separate thread).
-void Audio::Init(const vector<string> &sources)
+// Begin loading sounds (in separate threads). If isSilent is true, sounds
+// are mixed into a "loopback" device instead of the default output device,
+// so the audio code runs exactly as normal even with no sound hardware.
+void Audio::Init(const vector<string> &sources, bool isSilent)
 {
-	device = alcOpenDevice(nullptr);
+	device = isSilent ? OpenLoopback() : alcOpenDevice(nullptr);
 	if(!device)
 		return;
 	
-	context = alcCreateContext(device, nullptr);
+	// The loopback device must be told what format to mix into.
+	const ALCint loopbackAttributes[] = {
+		ALC_FORMAT_CHANNELS_SOFT, ALC_STEREO_SOFT,
+		ALC_FORMAT_TYPE_SOFT, ALC_SHORT_SOFT,
+		ALC_FREQUENCY, 44100,
+		0};
+	context = alcCreateContext(device, isSilent ? loopbackAttributes : nullptr);
 	if(!context || !alcMakeContextCurrent(context))
 		return;
+	if(isSilent)
+		loopbackBuffer.resize(2 * LOOPBACK_SAMPLES);
 	
 	// If we don't make it to this point, no audio will be played.
 	isInitialized = true;
@@ -143,6 +227,7 @@ void Audio::Init(const vector<string> &sources)
 	alDopplerFactor(0.);
 	
 	// Get all the sound files in the game data and all plugins.
+	map<string, string> paths;
 	for(const string &source : sources)
 	{
 		string root = source + "sounds/";
@@ -156,13 +241,36 @@ void Audio::Init(const vector<string> &sources)
 				size_t end = path.length() - 4;
 				if(path[end - 1] == '~')
 					--end;
-				loadQueue[path.substr(root.length(), end - root.length())] = path;
+				paths[path.substr(root.length(), end - root.length())] = path;
 			}
 		}
 	}
-	// Begin loading the files.
+	// Put the critical sounds at the front of the load queue. Also make sure
+	// every sound has an entry in the map, so the loading threads never need
+	// to add to it.
+	{
+		unique_lock<mutex> lock(audioMutex);
+		for(const auto &it : paths)
+		{
+			sounds[it.first];
+			if(CRITICAL.count(it.first))
+			{
+				loadQueue.push_front(it);
+				++criticalTotal;
+			}
+			else
+				loadQueue.push_back(it);
+		}
+		criticalRemaining = criticalTotal;
+	}
+	// Begin loading the files, spread over a few threads. Most of the time is
+	// spent reading the files, so this does not need one thread per core.
 	if(!loadQueue.empty())
-		loadThread = thread(&Load);
+	{
+		loadThreads.resize(max(1u, min(4u, thread::hardware_concurrency())));
+		for(thread &t : loadThreads)
+			t = thread(&Load);
+	}
 	
 	// Create the music-streaming threads.
 	currentTrack.reset(new Music());
@@ -172,8 +280,8 @@ void Audio::Init(const vector<string> &sources)
 	for(unsigned buffer : musicBuffers)
 	{
 		// Queue up blocks of silence to start out with.
-		const vector<int16_t> &chunk = currentTrack->NextChunk();
-		alBufferData(buffer, AL_FORMAT_STEREO16, &chunk.front(), 2 * chunk.size(), 44100);
+		const int16_t *chunk = currentTrack->NextChunk();
+		alBufferData(buffer, AL_FORMAT_STEREO16, chunk, 2 * Music::CHUNK_SIZE, 44100);
 	}
 	alSourceQueueBuffers(musicSource, MUSIC_BUFFERS, musicBuffers);
 	alSourcePlay(musicSource);
@@ -181,17 +289,16 @@ void Audio::Init(const vector<string> &sources)
 
 
 
-// Check the progress of loading sounds.
+// Check the progress of loading sounds. Only the sounds that are needed
+// right away are counted; the rest continue loading in the background.
 double Audio::Progress()
 {
 	unique_lock<mutex> lock(audioMutex);
 	
-	if(loadQueue.empty())
+	if(!criticalRemaining)
 		return 1.;
 	
-	double done = sounds.size();
-	double total = done + loadQueue.size();
-	return done / total;
+	return 1. - static_cast<double>(criticalRemaining) / criticalTotal;
 }
 
 
@@ -216,9 +323,24 @@ void Audio::SetVolume(double level)
 
 // Get a pointer to the named sound. The name is the path relative to the
 // "sound/" folder, and without ~ if it's on the end, or the extension.
+// If the sound has not been loaded yet, it will be loaded next. Until then,
+// playing it does nothing.
 const Sound *Audio::Get(const string &name)
 {
 	unique_lock<mutex> lock(audioMutex);
+	// If this sound is still waiting to be loaded, move it to the front of the
+	// queue, because it is probably about to be played.
+	for(auto it = loadQueue.begin(); it != loadQueue.end(); ++it)
+		if(it->first == name)
+		{
+			if(it != loadQueue.begin())
+			{
+				pair<string, string> entry = *it;
+				loadQueue.erase(it);
+				loadQueue.push_front(entry);
+			}
+			break;
+		}
 	return &sounds[name];
 }
 
@@ -232,11 +354,19 @@ void Audio::Update(const Point &listenerPosition)
 	if(!isInitialized)
 		return;
 	
+	Profiler::Timer timer(Profiler::AUDIO);
 	listener = listenerPosition;
 	
-	for(const auto &it : deferred)
-		queue[it.first].Add(it.second);
-	deferred.clear();
+	// Multiple requests for the same sound are coalesced into one queue entry.
+	const Sound *sound = nullptr;
+	Point position;
+	while(deferred.Pop(sound, position))
+	{
+		QueueEntry &entry = queue[sound];
+		if(entry.weight)
+			++current.coalesced;
+		entry.Add(position);
+	}
 }
 
 
@@ -256,15 +386,18 @@ void Audio::Play(const Sound *sound, const Point &position)
 	if(!isInitialized || !sound || !sound->Buffer() || !volume)
 		return;
 	
+	++requests;
 	// Place sounds from the main thread directly into the queue. They are from
 	// the UI, and the Engine may not be running right now to call Update().
 	if(this_thread::get_id() == mainThreadID)
-		queue[sound].Add(position - listener);
-	else
 	{
-		unique_lock<mutex> lock(audioMutex);
-		deferred[sound].Add(position - listener);
+		QueueEntry &entry = queue[sound];
+		if(entry.weight)
+			++current.coalesced;
+		entry.Add(position - listener);
 	}
+	else if(!deferred.Push(sound, position - listener))
+		++dropped;
 }
 
 
@@ -292,6 +425,7 @@ void Audio::Step()
 	if(!isInitialized)
 		return;
 	
+	Profiler::Timer timer(Profiler::AUDIO);
 	vector<Source> newSources;
 	// For each sound that is looping, see if it is going to continue. For other
 	// sounds, check if they are done playing.
@@ -349,6 +483,7 @@ void Audio::Step()
 	
 	// Now, what is left in the queue is sounds that want to play, and that do
 	// not correspond to an existing source.
+	size_t started = 0;
 	for(const auto &it : queue)
 	{
 		// Use a recycled source if possible. Otherwise, create a new one.
@@ -372,12 +507,16 @@ void Audio::Step()
 		{
 			source = recycledSources.back();
 			recycledSources.pop_back();
+			++current.recycled;
 		}
 		// Begin playing this sound.
 		sources.emplace_back(it.first, source);
 		sources.back().Move(it.second);
 		alSourcePlay(source);
+		++started;
 	}
+	// Any sounds that did not get a source are dropped.
+	current.dropped += queue.size() - started;
 	queue.clear();
 	
 	// Queue up new buffers for the music, if necessary.
@@ -388,19 +527,20 @@ void Audio::Step()
 		unsigned buffer = 0;
 		alSourceUnqueueBuffers(musicSource, 1, &buffer);
 		
-		const vector<int16_t> &chunk = currentTrack->NextChunk();
+		// The decoded music is handed directly to OpenAL, which makes its own
+		// copy of it. Only a cross-fade needs a separate buffer.
+		const int16_t *chunk = currentTrack->NextChunk();
 		
 		if(!musicFade)
-			alBufferData(buffer, AL_FORMAT_STEREO16, &chunk.front(), 2 * chunk.size(), 44100);
+			alBufferData(buffer, AL_FORMAT_STEREO16, chunk, 2 * Music::CHUNK_SIZE, 44100);
 		else
 		{
-			fadeBuffer.clear();
-			const vector<int16_t> &other = previousTrack->NextChunk();
-			for(size_t i = 0; i < chunk.size(); ++i)
+			fadeBuffer.resize(Music::CHUNK_SIZE);
+			const int16_t *other = previousTrack->NextChunk();
+			for(size_t i = 0; i < Music::CHUNK_SIZE; ++i)
 			{
 				// Blend the two tracks together.
-				fadeBuffer.push_back(
-					(musicFade * other[i] + (65536 - musicFade) * chunk[i]) / 65536);
+				fadeBuffer[i] = (musicFade * other[i] + (65536 - musicFade) * chunk[i]) / 65536;
 				
 				// Slowly fade into the new track.
 				if(musicFade)
@@ -414,8 +554,32 @@ void Audio::Step()
 		ALint state;
 		alGetSourcei(musicSource, AL_SOURCE_STATE, &state);
 		if(state != AL_PLAYING)
+		{
 			alSourcePlay(musicSource);
+			++musicStops;
+		}
 	}
+	
+	// If the audio is going to a loopback device, nothing will be played
+	// unless the samples are mixed here.
+	if(renderSamples)
+		renderSamples(device, &loopbackBuffer.front(), LOOPBACK_SAMPLES);
+	
+	// This frame is done, so record its statistics.
+	current.requests = requests.exchange(0);
+	current.dropped += dropped.exchange(0);
+	current.sources = sources.size();
+	current.underruns = musicStops + Music::Underruns();
+	previous = current;
+	current = Audio::Statistics();
+}
+
+
+
+// Get the statistics for the most recent frame.
+Audio::Statistics Audio::GetStatistics()
+{
+	return previous;
 }
 
 
@@ -426,14 +590,13 @@ void Audio::Quit()
 	// First, check if sounds are still being loaded in a separate thread, and
 	// if so interrupt that thread and wait for it to quit.
 	unique_lock<mutex> lock(audioMutex);
-	if(!loadQueue.empty())
-		loadQueue.clear();
-	if(loadThread.joinable())
-	{
-		lock.unlock();
-		loadThread.join();
-		lock.lock();
-	}
+	loadQueue.clear();
+	lock.unlock();
+	for(thread &t : loadThreads)
+		if(t.joinable())
+			t.join();
+	loadThreads.clear();
+	lock.lock();
 	
 	// Now, stop and delete any OpenAL sources that are playing.
 	for(const Source &source : sources)
@@ -512,6 +675,64 @@ namespace {
 	
 	
 	
+	RequestRing::RequestRing()
+		: tail(0)
+	{
+		for(size_t i = 0; i < SIZE; ++i)
+			slots[i].sequence.store(i, memory_order_relaxed);
+	}
+	
+	
+	
+	// Add a request. This returns false if there is no room for it.
+	bool RequestRing::Push(const Sound *sound, const Point &position)
+	{
+		size_t index = tail.load(memory_order_relaxed);
+		Slot *slot = nullptr;
+		while(true)
+		{
+			slot = &slots[index & (SIZE - 1)];
+			size_t sequence = slot->sequence.load(memory_order_acquire);
+			// If the sequence number matches, this slot is free. Try to claim it
+			// before any other thread does.
+			if(sequence == index)
+			{
+				if(tail.compare_exchange_weak(index, index + 1, memory_order_relaxed))
+					break;
+			}
+			// If the slot still holds a request from one lap around the ring
+			// ago, the ring is full.
+			else if(static_cast<ptrdiff_t>(sequence - index) < 0)
+				return false;
+			else
+				index = tail.load(memory_order_relaxed);
+		}
+		slot->sound = sound;
+		slot->position = position;
+		// Mark the slot as ready to be read.
+		slot->sequence.store(index + 1, memory_order_release);
+		return true;
+	}
+	
+	
+	
+	// Remove the oldest request. This returns false if the ring is empty.
+	bool RequestRing::Pop(const Sound *&sound, Point &position)
+	{
+		Slot &slot = slots[head & (SIZE - 1)];
+		if(slot.sequence.load(memory_order_acquire) != head + 1)
+			return false;
+		
+		sound = slot.sound;
+		position = slot.position;
+		// Mark the slot as free for the next lap around the ring.
+		slot.sequence.store(head + SIZE, memory_order_release);
+		++head;
+		return true;
+	}
+	
+	
+	
 	// This is a wrapper for an OpenAL audio source.
 	Source::Source(const Sound *sound, unsigned source)
 		: sound(sound), source(source)
@@ -558,28 +779,50 @@ namespace {
 	
 	
 	
+	// Open a loopback device, if that extension is available.
+	ALCdevice *OpenLoopback()
+	{
+		if(!alcIsExtensionPresent(nullptr, "ALC_SOFT_loopback"))
+			return nullptr;
+		
+		LoopbackOpenDevice openDevice = reinterpret_cast<LoopbackOpenDevice>(
+			alcGetProcAddress(nullptr, "alcLoopbackOpenDeviceSOFT"));
+		renderSamples = reinterpret_cast<RenderSamples>(
+			alcGetProcAddress(nullptr, "alcRenderSamplesSOFT"));
+		if(!openDevice || !renderSamples)
+		{
+			renderSamples = nullptr;
+			return nullptr;
+		}
+		return openDevice(nullptr);
+	}
+	
+	
+	
 	// Thread entry point for loading sounds.
 	void Load()
 	{
 		string name;
 		string path;
+		Sound *sound = nullptr;
 		while(true)
 		{
 			{
 				unique_lock<mutex> lock(audioMutex);
-				// If this is not the first time through, remove the previous item
-				// in the queue. This is a signal that it has been loaded, so we
-				// must not remove it until after loading the file.
-				if(!path.empty() && !loadQueue.empty())
-					loadQueue.erase(loadQueue.begin());
+				// If this is not the first time through, the previous sound is
+				// done loading.
+				if(sound && CRITICAL.count(name) && criticalRemaining)
+					--criticalRemaining;
 				if(loadQueue.empty())
 					return;
-				name = loadQueue.begin()->first;
-				path = loadQueue.begin()->second;
+				name = loadQueue.front().first;
+				path = loadQueue.front().second;
+				loadQueue.pop_front();
+				sound = &sounds[name];
 			}
 			
 			// Unlock the mutex for the time-intensive part of the loop.
-			if(!sounds[name].Load(path, name))
+			if(!sound->Load(path, name))
 				Files::LogError("Unable to load sound \"" + name + "\" from path: " + path);
 		}
 	}
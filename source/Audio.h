@@ -30,10 +30,33 @@ class Sound;
 // their source stops calling the "play" function for them.
 class Audio {
 public:
-	// Begin loading sounds (in a separate thread).
-	static void Init(const std::vector<std::string> &sources);
+	// Counts of what the audio system did during the most recent frame, for
+	// the debug overlay.
+	class Statistics {
+	public:
+		// Number of sounds that were requested to play.
+		int requests = 0;
+		// Requests that were merged with another request for the same sound.
+		int coalesced = 0;
+		// Requests that were ignored because there was no room for them.
+		int dropped = 0;
+		// Sources that were reused for a different sound.
+		int recycled = 0;
+		// Number of sources that are currently playing.
+		int sources = 0;
+		// Total number of times the music has run out of buffered data.
+		int underruns = 0;
+	};
 	
-	// Check the progress of loading sounds.
+	
+public:
+	// Begin loading sounds (in separate threads). If isSilent is true, sounds
+	// are mixed into a "loopback" device instead of the default output device,
+	// so the audio code runs exactly as normal even with no sound hardware.
+	static void Init(const std::vector<std::string> &sources, bool isSilent = false);
+	
+	// Check the progress of loading sounds. Only the sounds that are needed
+	// right away are counted; the rest continue loading in the background.
 	static double Progress();
 	
 	// Get or set the volume (between 0 and 1).
@@ -42,7 +65,8 @@ public:
 	
 	// Get a pointer to the named sound. The name is the path relative to the
 	// "sound/" folder, and without ~ if it's on the end, or the extension.
-	// Do not call this function until Progress() is 100%.
+	// If the sound has not been loaded yet, it will be loaded next. Until then,
+	// playing it does nothing.
 	static const Sound *Get(const std::string &name);
 	
 	// Set the listener's position, and also update any sounds that have been
@@ -64,6 +88,9 @@ public:
 	// this function was called.
 	static void Step();
 	
+	// Get the statistics for the most recent frame.
+	static Statistics GetStatistics();
+	
 	// Shut down the audio system (because we're about to quit).
 	static void Quit();
 };
@@ -22,13 +22,15 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 using namespace std;
 
 namespace {
-	void Push(vector<float> &v, const Point &pos, float s, float t, float frame)
+	void Push(vector<float> &v, const Point &pos, float s, float t, float frame, const Point &velocity)
 	{
 		v.push_back(pos.X());
 		v.push_back(pos.Y());
 		v.push_back(s);
 		v.push_back(t);
 		v.push_back(frame);
+		v.push_back(velocity.X());
+		v.push_back(velocity.Y());
 	}
 }
 
@@ -37,7 +39,9 @@ namespace {
 // Clear the list, also setting the global time step for animation.
 void BatchDrawList::Clear(int step, double zoom)
 {
-	data.clear();
+	for(size_t i = 0; i < sprites.size(); ++i)
+		data[i].clear();
+	sprites.clear();
 	this->step = step;
 	this->zoom = zoom;
 	isHighDPI = (Screen::IsHighResolution() ? zoom > .5 : zoom > 1.);
@@ -45,9 +49,10 @@ void BatchDrawList::Clear(int step, double zoom)
 
 
 
-void BatchDrawList::SetCenter(const Point &center)
+void BatchDrawList::SetCenter(const Point &center, const Point &centerVelocity)
 {
 	this->center = center;
+	this->centerVelocity = centerVelocity;
 }
 
 
@@ -60,9 +65,11 @@ bool BatchDrawList::Add(const Body &body, float clip)
 		return false;
 	
 	// Get the data vector for this particular sprite.
-	vector<float> &v = data[body.GetSprite()];
-	// The sprite frame is the same for every vertex.
+	size_t index = Index(body.GetSprite());
+	vector<float> &v = data[index];
+	// The sprite frame and velocity are the same for every vertex.
 	float frame = body.GetFrame(step);
+	Point velocity = (body.Velocity() - centerVelocity) * zoom;
 	
 	// Get unit vectors in the direction of the object's width and height.
 	Point unit = body.Unit() * zoom;
@@ -82,31 +89,74 @@ bool BatchDrawList::Add(const Body &body, float clip)
 	
 	// Push two copies of the first and last vertices to mark the break between
 	// the sprites.
-	Push(v, topLeft, 0.f, 1.f, frame);
-	Push(v, topLeft, 0.f, 1.f, frame);
-	Push(v, topRight, 1.f, 1.f, frame);
-	Push(v, bottomLeft, 0.f, 1.f - clip, frame);
-	Push(v, bottomRight, 1.f, 1.f - clip, frame);
-	Push(v, bottomRight, 1.f, 1.f - clip, frame);
+	Push(v, topLeft, 0.f, 1.f, frame, velocity);
+	Push(v, topLeft, 0.f, 1.f, frame, velocity);
+	Push(v, topRight, 1.f, 1.f, frame, velocity);
+	Push(v, bottomLeft, 0.f, 1.f - clip, frame, velocity);
+	Push(v, bottomRight, 1.f, 1.f - clip, frame, velocity);
+	Push(v, bottomRight, 1.f, 1.f - clip, frame, velocity);
 	
 	return true;
 }
 
 
 
-// Draw all the items in this list.
-void BatchDrawList::Draw() const
+// Draw all the items in this list. If the lag is not zero, each item is
+// drawn that fraction of a step back along its motion.
+void BatchDrawList::Draw(double lag) const
 {
-	BatchShader::Bind();
+	if(sprites.empty())
+		return;
 	
-	for(const pair<const Sprite *, vector<float>> &it : data)
-		BatchShader::Add(it.first, isHighDPI, it.second);
+	// The shader moves each vertex back along its velocity by the lag.
+	BatchShader::Bind(lag);
+	
+	// Upload all the vertex data into a single buffer before drawing any of it.
+	size_t size = 0;
+	for(size_t i = 0; i < sprites.size(); ++i)
+		size += data[i].size();
+	BatchShader::Allocate(size);
+	
+	size_t offset = 0;
+	for(size_t i = 0; i < sprites.size(); ++i)
+	{
+		BatchShader::Upload(data[i], offset);
+		offset += data[i].size();
+	}
+	
+	offset = 0;
+	for(size_t i = 0; i < sprites.size(); ++i)
+	{
+		BatchShader::Add(sprites[i], isHighDPI, offset, data[i].size());
+		offset += data[i].size();
+	}
 	
 	BatchShader::Unbind();
 }
 
 
 
+// Get the index of the vertex data for the given sprite, adding it to the
+// list if it has not been drawn yet in this frame.
+size_t BatchDrawList::Index(const Sprite *sprite)
+{
+	// Bodies with the same sprite are usually added one after another, and
+	// there are rarely more than a few dozen different sprites in a frame, so a
+	// linear search is faster than any sort of map.
+	if(lastIndex < sprites.size() && sprites[lastIndex] == sprite)
+		return lastIndex;
+	for(lastIndex = 0; lastIndex < sprites.size(); ++lastIndex)
+		if(sprites[lastIndex] == sprite)
+			return lastIndex;
+	
+	sprites.push_back(sprite);
+	if(data.size() < sprites.size())
+		data.emplace_back();
+	return lastIndex;
+}
+
+
+
 bool BatchDrawList::Cull(const Body &body, const Point &position) const
 {
 	if(!body.HasSprite() || !body.Zoom())
@@ -15,7 +15,7 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 
 #include "Point.h"
 
-#include <map>
+#include <cstddef>
 #include <vector>
 
 class Body;
@@ -29,17 +29,21 @@ class BatchDrawList {
 public:
 	// Clear the list, also setting the global time step for animation.
 	void Clear(int step = 0, double zoom = 1.);
-	void SetCenter(const Point &center);
+	void SetCenter(const Point &center, const Point &centerVelocity = Point());
 	
 	// Add an object based on the Body class.
 	bool Add(const Body &body, float clip = 1.f);
 	
-	// Draw all the items in this list.
-	void Draw() const;
+	// Draw all the items in this list. If the lag is not zero, each item is
+	// drawn that fraction of a step back along its motion.
+	void Draw(double lag = 0.) const;
 	
 	
 private:
 	bool Cull(const Body &body, const Point &position) const;
+	// Get the index of the vertex data for the given sprite, adding it to the
+	// list if it has not been drawn yet in this frame.
+	size_t Index(const Sprite *sprite);
 	
 	
 private:
@@ -47,12 +51,19 @@ private:
 	double zoom = 1.;
 	bool isHighDPI = false;
 	Point center;
+	Point centerVelocity;
 	
 	// Each sprite consists of six vertices (four vertices to form a quad and
 	// two dummy vertices to mark the break in between them). Each of those
-	// vertices has five attributes: (x, y) position in pixels, (s, t) texture
-	// coordinates, and the index of the sprite frame.
-	std::map<const Sprite *, std::vector<float>> data;
+	// vertices has seven attributes: (x, y) position in pixels, (s, t) texture
+	// coordinates, the index of the sprite frame, and the (x, y) velocity
+	// relative to the center in pixels per step. The sprites are stored in
+	// the order they were first added, with data[i] holding the vertices for
+	// sprites[i]. Clearing the list does not free the vertex vectors, so after
+	// the first few frames no memory needs to be allocated.
+	std::vector<const Sprite *> sprites;
+	std::vector<std::vector<float>> data;
+	size_t lastIndex = 0;
 };
 
 
@@ -16,6 +16,8 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #include "Shader.h"
 #include "Sprite.h"
 
+#include <algorithm>
+
 using namespace std;
 
 namespace {
@@ -23,12 +25,17 @@ namespace {
 	// Uniforms:
 	GLint scaleI;
 	GLint frameCountI;
+	GLint lagI;
 	// Vertex data:
 	GLint vertI;
 	GLint texCoordI;
+	GLint velocityI;
 	
 	GLuint vao;
 	GLuint vbo;
+	// Current size of the vertex buffer, in floats. The buffer never shrinks,
+	// so that the driver can recycle the same storage every frame.
+	size_t capacity = 0;
 }
 
 
@@ -38,13 +45,15 @@ void BatchShader::Init()
 {
 	static const char *vertexCode =
 		"uniform vec2 scale;\n"
+		"uniform float lag;\n"
 		"in vec2 vert;\n"
 		"in vec3 texCoord;\n"
+		"in vec2 velocity;\n"
 		
 		"out vec3 fragTexCoord;\n"
 		
 		"void main() {\n"
-		"  gl_Position = vec4(vert * scale, 0, 1);\n"
+		"  gl_Position = vec4((vert + lag * velocity) * scale, 0, 1);\n"
 		"  fragTexCoord = texCoord;\n"
 		"}\n";
 	
@@ -70,8 +79,10 @@ void BatchShader::Init()
 	// Get the indices of the uniforms and attributes.
 	scaleI = shader.Uniform("scale");
 	frameCountI = shader.Uniform("frameCount");
+	lagI = shader.Uniform("lag");
 	vertI = shader.Attrib("vert");
 	texCoordI = shader.Attrib("texCoord");
+	velocityI = shader.Attrib("velocity");
 	
 	// Make sure we're using texture 0.
 	glUseProgram(shader.Object());
@@ -85,11 +96,13 @@ void BatchShader::Init()
 	glGenBuffers(1, &vbo);
 	glBindBuffer(GL_ARRAY_BUFFER, vbo);
 	
-	// In this VAO, enable the two vertex arrays and specify their byte offsets.
+	// In this VAO, enable the three vertex arrays and specify their byte offsets.
 	glEnableVertexAttribArray(vertI);
-	glVertexAttribPointer(vertI, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void *)0);
+	glVertexAttribPointer(vertI, 2, GL_FLOAT, GL_FALSE, 7 * sizeof(float), (void *)0);
 	glEnableVertexAttribArray(texCoordI);
-	glVertexAttribPointer(texCoordI, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void *)(2 * sizeof(float)));
+	glVertexAttribPointer(texCoordI, 3, GL_FLOAT, GL_FALSE, 7 * sizeof(float), (void *)(2 * sizeof(float)));
+	glEnableVertexAttribArray(velocityI);
+	glVertexAttribPointer(velocityI, 2, GL_FLOAT, GL_FALSE, 7 * sizeof(float), (void *)(5 * sizeof(float)));
 	
 	// Unbind the buffer and the VAO, but leave the vertex attrib arrays enabled
 	// in the VAO so they will be used when it is bound.
@@ -99,7 +112,9 @@ void BatchShader::Init()
 
 
 
-void BatchShader::Bind()
+// Bind the shader. Each vertex is drawn the given fraction of a step back
+// along its velocity.
+void BatchShader::Bind(double lag)
 {
 	glUseProgram(shader.Object());
 	glBindVertexArray(vao);
@@ -109,14 +124,35 @@ void BatchShader::Bind()
 	// Set up the screen scale.
 	GLfloat scale[2] = {2.f / Screen::Width(), -2.f / Screen::Height()};
 	glUniform2fv(scaleI, 1, scale);
+	glUniform1f(lagI, lag);
+}
+
+
+
+// Orphan the vertex buffer and make sure it has room for the given number
+// of floats. This must be done before uploading any data for this frame.
+void BatchShader::Allocate(size_t size)
+{
+	capacity = max(capacity, size);
+	// Passing a null pointer tells the driver the old contents are no longer
+	// needed, so it does not have to wait for the previous frame's draw calls.
+	glBufferData(GL_ARRAY_BUFFER, sizeof(float) * capacity, nullptr, GL_STREAM_DRAW);
 }
 
 
 
-void BatchShader::Add(const Sprite *sprite, bool isHighDPI, const vector<float> &data)
+void BatchShader::Upload(const vector<float> &data, size_t offset)
+{
+	if(!data.empty())
+		glBufferSubData(GL_ARRAY_BUFFER, sizeof(float) * offset, sizeof(float) * data.size(), data.data());
+}
+
+
+
+void BatchShader::Add(const Sprite *sprite, bool isHighDPI, size_t offset, size_t size)
 {
 	// Do nothing if there are no sprites to draw.
-	if(data.empty())
+	if(!size)
 		return;
 	
 	// First, bind the proper texture.
@@ -124,11 +160,8 @@ void BatchShader::Add(const Sprite *sprite, bool isHighDPI, const vector<float>
 	// The shader also needs to know how many frames the texture has.
 	glUniform1f(frameCountI, sprite->Frames());
 	
-	// Upload the vertex data.
-	glBufferData(GL_ARRAY_BUFFER, sizeof(float) * data.size(), data.data(), GL_STREAM_DRAW);
-	
 	// Draw all the vertices.
-	glDrawArrays(GL_TRIANGLE_STRIP, 0, data.size() / 5);
+	glDrawArrays(GL_TRIANGLE_STRIP, offset / 7, size / 7);
 }
 
 
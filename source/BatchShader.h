@@ -15,19 +15,28 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 
 class Sprite;
 
+#include <cstddef>
 #include <vector>
 
 
 
-// Class for drawing sprites in a batch. The input to each draw command is a
-// sprite, whether it should be drawn high DPI, and the vertex data.
+// Class for drawing sprites in a batch. All the vertex data for a frame is
+// uploaded into a single buffer, and then each draw command specifies a sprite,
+// whether it should be drawn high DPI, and which range of that buffer to draw.
+// Offsets and sizes are given as a number of floats.
 class BatchShader {
 public:
 	// Initialize the shaders.
 	static void Init();
 	
-	static void Bind();
-	static void Add(const Sprite *sprite, bool isHighDPI, const std::vector<float> &data);
+	// Bind the shader. Each vertex is drawn the given fraction of a step back
+	// along its velocity.
+	static void Bind(double lag = 0.);
+	// Orphan the vertex buffer and make sure it has room for the given number
+	// of floats. This must be done before uploading any data for this frame.
+	static void Allocate(size_t size);
+	static void Upload(const std::vector<float> &data, size_t offset);
+	static void Add(const Sprite *sprite, bool isHighDPI, size_t offset, size_t size);
 	static void Unbind();
 };
 
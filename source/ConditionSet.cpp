@@ -12,6 +12,7 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 
 #include "ConditionSet.h"
 
+#include "ConditionsStore.h"
 #include "DataNode.h"
 #include "DataWriter.h"
 #include "Random.h"
@@ -19,10 +20,14 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #include <algorithm>
 #include <cmath>
 #include <limits>
+#include <map>
 
 using namespace std;
 
 namespace {
+	// Marker for an expression with a constant value instead of a dynamic one.
+	const size_t NO_SLOT = static_cast<size_t>(-1);
+	
 	typedef int64_t (*BinFun)(int64_t, int64_t);
 	BinFun Op(const string &op)
 	{
@@ -190,20 +195,19 @@ bool ConditionSet::Add(const string &name, const string &op, const string &strVa
 	if(!fun)
 		return false;
 	
-	expressions.emplace_back(name, op, 0);
-	expressions.back().strValue = strValue;
+	expressions.emplace_back(name, op, 0, strValue);
 	return true;
 }
 
 
 
 // Check if the given condition values satisfy this set of conditions.
-bool ConditionSet::Test(const map<string, int64_t> &conditions) const
+bool ConditionSet::Test(const ConditionsStore &conditions) const
 {
 	for(const Expression &expression : expressions)
 	{
-		auto firstValue = TokenValue(0, expression.name, conditions);
-		auto secondValue = TokenValue(expression.value, expression.strValue, conditions);
+		auto firstValue = expression.Left(conditions);
+		auto secondValue = expression.Right(conditions);
 		bool result = expression.fun(firstValue, secondValue);
 		// If this is a set of "and" conditions, bail out as soon as one of them
 		// returns false. If it is an "or", bail out if anything returns true.
@@ -225,12 +229,12 @@ bool ConditionSet::Test(const map<string, int64_t> &conditions) const
 
 
 // Modify the given set of conditions.
-void ConditionSet::Apply(map<string, int64_t> &conditions) const
+void ConditionSet::Apply(ConditionsStore &conditions) const
 {
 	for(const Expression &expression : expressions)
 	{
-		auto &c = conditions[expression.name];
-		auto value = TokenValue(expression.value, expression.strValue, conditions);
+		auto &c = conditions.Get(expression.slot);
+		auto value = expression.Right(conditions);
 		c = expression.fun(c, value);
 	}
 	// Note: "and" and "or" make no sense for "Apply()," so a condition set that
@@ -242,27 +246,38 @@ void ConditionSet::Apply(map<string, int64_t> &conditions) const
 
 
 
-// Check if the passed token is numeric or a string which has to be replaced, and return its value
-int64_t ConditionSet::TokenValue(int64_t numValue, const string &strValue, const map<string, int64_t> &conditions) const
+// Constructor for an expression.
+ConditionSet::Expression::Expression(const string &name, const string &op, int64_t value, const string &strValue)
+	: name(name), op(op), fun(Op(op)), value(value), strValue(strValue),
+	slot(ConditionsStore::Slot(name)), valueSlot(strValue.empty() ? NO_SLOT : ConditionsStore::Slot(strValue)),
+	isRandom(name == "random"), isValueRandom(strValue == "random")
+{
+}
+
+
+
+// Get the value of the condition, or of the other side of the expression.
+// Either may be "random," which means a random number from 0 to 99.
+int64_t ConditionSet::Expression::Left(const ConditionsStore &conditions) const
 {
-	auto value = numValue;
 	// Special case: if the string of the token is "random," that means to
 	// generate a random number from 0 to 99 each time it is queried.
-	if(strValue == "random")
-		value = Random::Int(100);
-	else
-	{
-		auto it = conditions.find(strValue);
-		if(it != conditions.end())
-			value = it->second;
-	}
-	return value;
+	if(isRandom)
+		return Random::Int(100);
+	
+	const int64_t *it = conditions.Find(slot);
+	return it ? *it : 0;
 }
 
 
 
-// Constructor for an expression.
-ConditionSet::Expression::Expression(const string &name, const string &op, int64_t value)
-	: name(name), op(op), fun(Op(op)), value(value)
+int64_t ConditionSet::Expression::Right(const ConditionsStore &conditions) const
 {
+	if(isValueRandom)
+		return Random::Int(100);
+	if(valueSlot == NO_SLOT)
+		return value;
+	
+	const int64_t *it = conditions.Find(valueSlot);
+	return it ? *it : value;
 }
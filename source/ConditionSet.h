@@ -13,10 +13,12 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #ifndef CONDITION_SET_H_
 #define CONDITION_SET_H_
 
-#include <map>
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <vector>
 
+class ConditionsStore;
 class DataNode;
 class DataWriter;
 
@@ -25,7 +27,8 @@ class DataWriter;
 // A condition set is a collection of operations on the player's set of named
 // "conditions". This includes "test" operations that just check the values of
 // those conditions, and other operations that can be "applied" to change the
-// values.
+// values. The condition names are turned into slots in the ConditionsStore
+// when the set is loaded, so testing it does not involve any string lookups.
 class ConditionSet {
 public:
 	ConditionSet() = default;
@@ -47,14 +50,9 @@ public:
 	bool Add(const std::string &name, const std::string &op, const std::string &strValue);
 	
 	// Check if the given condition values satisfy this set of conditions.
-	bool Test(const std::map<std::string, int64_t> &conditions) const;
+	bool Test(const ConditionsStore &conditions) const;
 	// Modify the given set of conditions.
-	void Apply(std::map<std::string, int64_t> &conditions) const;
-	
-	
-private:
-	// Check if the passed token is numeric or a string which has to be replaced, and return its value
-	int64_t TokenValue(int64_t numValue, const std::string &strValue, const std::map<std::string, int64_t> &conditions) const;
+	void Apply(ConditionsStore &conditions) const;
 	
 	
 private:
@@ -62,7 +60,12 @@ private:
 	// testing what value it has, or modifying it in some way.
 	class Expression {
 	public:
-		Expression(const std::string &name, const std::string &op, int64_t value);
+		Expression(const std::string &name, const std::string &op, int64_t value, const std::string &strValue = "");
+		
+		// Get the value of the condition, or of the other side of the expression.
+		// Either may be "random," which means a random number from 0 to 99.
+		int64_t Left(const ConditionsStore &conditions) const;
+		int64_t Right(const ConditionsStore &conditions) const;
 		
 		// This is the name of the condition that this entry operates on.
 		std::string name;
@@ -75,6 +78,13 @@ private:
 		int64_t value;
 		// Allow for dynamic values.
 		std::string strValue;
+		
+		// The slots of the named condition and of the dynamic value (if any).
+		// These are resolved when the expression is loaded.
+		size_t slot;
+		size_t valueSlot;
+		bool isRandom;
+		bool isValueRandom;
 	};
 	
 	
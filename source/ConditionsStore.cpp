@@ -0,0 +1,229 @@
+/* ConditionsStore.cpp
+Copyright (c) 2026 by Endless Sky contributors
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#include "ConditionsStore.h"
+
+#include <deque>
+#include <mutex>
+
+using namespace std;
+
+namespace {
+	// The names of all the slots that have been handed out. A deque is used so
+	// that references to the names stay valid when more are added.
+	mutex slotMutex;
+	map<string, size_t> slotIndex;
+	deque<string> slotNames;
+	
+	const string &SlotName(size_t slot)
+	{
+		lock_guard<mutex> lock(slotMutex);
+		return slotNames[slot];
+	}
+}
+
+
+
+// Copying a store must not copy the slot lookup table, because it points
+// into the other store's values.
+ConditionsStore::ConditionsStore(const ConditionsStore &other)
+	: conditions(other.conditions)
+{
+}
+
+
+
+ConditionsStore &ConditionsStore::operator=(const ConditionsStore &other)
+{
+	conditions = other.conditions;
+	Removed();
+	return *this;
+}
+
+
+
+// Get the slot for the condition with the given name. The same name always
+// maps to the same slot, in every store. This is safe to call from any thread.
+size_t ConditionsStore::Slot(const string &name)
+{
+	lock_guard<mutex> lock(slotMutex);
+	auto it = slotIndex.find(name);
+	if(it != slotIndex.end())
+		return it->second;
+	
+	slotNames.push_back(name);
+	return slotIndex[name] = slotNames.size() - 1;
+}
+
+
+
+// Get a pointer to the value of the condition in the given slot, or null if
+// that condition has not been set.
+const int64_t *ConditionsStore::Find(size_t slot) const
+{
+	if(slot < entries.size())
+	{
+		const Entry &entry = entries[slot];
+		if(entry.value || entry.generation == generation)
+			return entry.value;
+	}
+	return Resolve(slot);
+}
+
+
+
+// Get the value of the condition in the given slot, adding it (with a value
+// of zero) if it has not been set.
+int64_t &ConditionsStore::Get(size_t slot)
+{
+	int64_t *value = const_cast<int64_t *>(Find(slot));
+	if(value)
+		return *value;
+	
+	value = &(*this)[SlotName(slot)];
+	entries[slot].value = value;
+	return *value;
+}
+
+
+
+// Access the conditions by name, in the same way as a std::map.
+int64_t &ConditionsStore::operator[](const string &name)
+{
+	auto it = conditions.lower_bound(name);
+	if(it == conditions.end() || it->first != name)
+	{
+		it = conditions.emplace_hint(it, name, 0);
+		Added();
+	}
+	return it->second;
+}
+
+
+
+ConditionsStore::iterator ConditionsStore::find(const string &name)
+{
+	return conditions.find(name);
+}
+
+
+
+ConditionsStore::const_iterator ConditionsStore::find(const string &name) const
+{
+	return conditions.find(name);
+}
+
+
+
+ConditionsStore::iterator ConditionsStore::lower_bound(const string &name)
+{
+	return conditions.lower_bound(name);
+}
+
+
+
+ConditionsStore::const_iterator ConditionsStore::lower_bound(const string &name) const
+{
+	return conditions.lower_bound(name);
+}
+
+
+
+ConditionsStore::iterator ConditionsStore::begin()
+{
+	return conditions.begin();
+}
+
+
+
+ConditionsStore::const_iterator ConditionsStore::begin() const
+{
+	return conditions.begin();
+}
+
+
+
+ConditionsStore::iterator ConditionsStore::end()
+{
+	return conditions.end();
+}
+
+
+
+ConditionsStore::const_iterator ConditionsStore::end() const
+{
+	return conditions.end();
+}
+
+
+
+bool ConditionsStore::empty() const
+{
+	return conditions.empty();
+}
+
+
+
+size_t ConditionsStore::erase(const string &name)
+{
+	size_t count = conditions.erase(name);
+	if(count)
+		Removed();
+	return count;
+}
+
+
+
+void ConditionsStore::erase(iterator first, iterator last)
+{
+	if(first == last)
+		return;
+	
+	conditions.erase(first, last);
+	Removed();
+}
+
+
+
+// Look up the given slot by name, and remember where its value is stored.
+int64_t *ConditionsStore::Resolve(size_t slot) const
+{
+	if(slot >= entries.size())
+		entries.resize(slot + 1);
+	
+	// The map is only const because this function is; the pointer is handed
+	// out as a const pointer unless the store itself is mutable.
+	auto it = conditions.find(SlotName(slot));
+	Entry &entry = entries[slot];
+	entry.value = (it == conditions.end()) ? nullptr : const_cast<int64_t *>(&it->second);
+	entry.generation = generation;
+	return entry.value;
+}
+
+
+
+// Call this when an element is added to or removed from the map.
+void ConditionsStore::Added()
+{
+	// Any pointers that are cached are still valid, but a condition that was
+	// not set before might be now.
+	++generation;
+}
+
+
+
+void ConditionsStore::Removed()
+{
+	// The cached pointers may now point to elements that no longer exist.
+	entries.clear();
+	++generation;
+}
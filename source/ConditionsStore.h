@@ -0,0 +1,97 @@
+/* ConditionsStore.h
+Copyright (c) 2026 by Endless Sky contributors
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#ifndef CONDITIONS_STORE_H_
+#define CONDITIONS_STORE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+
+
+// The player's named "conditions," and their values. This can be used just
+// like a map from names to values, but each condition name can also be turned
+// into an integer "slot" once (when the data files are loaded), and looking
+// up a condition by its slot does not need any string comparisons. Condition
+// sets use slots, because they are tested many times every time you land.
+class ConditionsStore {
+public:
+	typedef std::map<std::string, int64_t>::iterator iterator;
+	typedef std::map<std::string, int64_t>::const_iterator const_iterator;
+	
+	
+public:
+	ConditionsStore() = default;
+	// Copying a store must not copy the slot lookup table, because it points
+	// into the other store's values.
+	ConditionsStore(const ConditionsStore &other);
+	ConditionsStore &operator=(const ConditionsStore &other);
+	
+	// Get the slot for the condition with the given name. The same name always
+	// maps to the same slot, in every store. This is safe to call from any thread.
+	static size_t Slot(const std::string &name);
+	
+	// Get a pointer to the value of the condition in the given slot, or null if
+	// that condition has not been set.
+	const int64_t *Find(size_t slot) const;
+	// Get the value of the condition in the given slot, adding it (with a value
+	// of zero) if it has not been set.
+	int64_t &Get(size_t slot);
+	
+	// Access the conditions by name, in the same way as a std::map.
+	int64_t &operator[](const std::string &name);
+	iterator find(const std::string &name);
+	const_iterator find(const std::string &name) const;
+	iterator lower_bound(const std::string &name);
+	const_iterator lower_bound(const std::string &name) const;
+	iterator begin();
+	const_iterator begin() const;
+	iterator end();
+	const_iterator end() const;
+	bool empty() const;
+	size_t erase(const std::string &name);
+	void erase(iterator first, iterator last);
+	
+	
+private:
+	// Look up the given slot by name, and remember where its value is stored.
+	int64_t *Resolve(size_t slot) const;
+	// Call this when an element is added to or removed from the map.
+	void Added();
+	void Removed();
+	
+	
+private:
+	// An entry in the slot lookup table. Elements of a std::map never move, so
+	// a pointer to the value remains valid until that element is erased. If
+	// the value is null, the condition was not set as of the given generation.
+	class Entry {
+	public:
+		int64_t *value = nullptr;
+		size_t generation = 0;
+	};
+	
+	
+private:
+	std::map<std::string, int64_t> conditions;
+	// The generation is incremented whenever a condition is added, so that any
+	// cached "not set" entries will be looked up again.
+	size_t generation = 1;
+	mutable std::vector<Entry> entries;
+};
+
+
+
+#endif
@@ -14,8 +14,69 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 
 #include "Files.h"
 
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <utility>
+#include <vector>
+
 using namespace std;
 
+namespace {
+	// Binary data files begin with this signature, followed by a version
+	// number. No text data file can begin with a "delete" character.
+	const char SIGNATURE[] = "\x7F" "ESB" "\x01";
+	const size_t SIGNATURE_SIZE = sizeof(SIGNATURE) - 1;
+	
+	
+	
+	// Numbers are stored seven bits per byte, with the high bit set in every
+	// byte but the last one. Most numbers fit in a single byte.
+	void WriteNumber(string &out, size_t value)
+	{
+		while(value >= 0x80)
+		{
+			out += static_cast<char>((value & 0x7F) | 0x80);
+			value >>= 7;
+		}
+		out += static_cast<char>(value);
+	}
+	
+	
+	
+	bool ReadNumber(const char *&it, const char *end, size_t &value)
+	{
+		value = 0;
+		for(int shift = 0; it != end && shift < 64; shift += 7)
+		{
+			unsigned char byte = *it++;
+			value |= static_cast<size_t>(byte & 0x7F) << shift;
+			if(!(byte & 0x80))
+				return true;
+		}
+		return false;
+	}
+	
+	
+	
+	// Add a node and all its children to the binary data, adding any tokens that
+	// have not been seen before to the table of tokens.
+	void Encode(const DataNode &node, map<string, size_t> &index, vector<const string *> &tokens, string &out)
+	{
+		WriteNumber(out, node.Size());
+		for(int i = 0; i < node.Size(); ++i)
+		{
+			auto it = index.emplace(node.Token(i), tokens.size());
+			if(it.second)
+				tokens.push_back(&it.first->first);
+			WriteNumber(out, it.first->second);
+		}
+		WriteNumber(out, distance(node.begin(), node.end()));
+		for(const DataNode &child : node)
+			Encode(child, index, tokens, out);
+	}
+}
+
 
 
 // Constructor, taking a file path (in UTF-8).
@@ -92,9 +153,47 @@ list<DataNode>::const_iterator DataFile::end() const
 
 
 
+// Encode all the nodes in this file in the binary form. This is much smaller
+// and faster to load than the text form if many tokens are repeated, as in
+// saved games. Comments are not preserved, but all the tokens are.
+string DataFile::ToBinary() const
+{
+	map<string, size_t> index;
+	vector<const string *> tokens;
+	string nodes;
+	WriteNumber(nodes, distance(begin(), end()));
+	for(const DataNode &node : *this)
+		Encode(node, index, tokens, nodes);
+	
+	string out(SIGNATURE, SIGNATURE_SIZE);
+	WriteNumber(out, tokens.size());
+	for(const string *token : tokens)
+	{
+		WriteNumber(out, token->length());
+		out += *token;
+	}
+	return out + nodes;
+}
+
+
+
+// Check whether the given file contents are in the binary form.
+bool DataFile::IsBinary(const string &data)
+{
+	return !data.compare(0, SIGNATURE_SIZE, SIGNATURE, SIGNATURE_SIZE);
+}
+
+
+
 // Parse the given text.
 void DataFile::Load(const char *it, const char *end)
 {
+	if(static_cast<size_t>(end - it) >= SIGNATURE_SIZE && equal(it, it + SIGNATURE_SIZE, SIGNATURE))
+	{
+		LoadBinary(it + SIGNATURE_SIZE, end);
+		return;
+	}
+	
 	// Keep track of the current stack of indentation levels and the most recent
 	// node at each level - that is, the node that will be the "parent" of any
 	// new node added at the next deeper indentation level.
@@ -202,3 +301,59 @@ void DataFile::Load(const char *it, const char *end)
 		}
 	}
 }
+
+
+
+// Decode data in the binary form. Any data after the end of the node tree
+// (such as the newline that is added to the end of every file) is ignored.
+void DataFile::LoadBinary(const char *it, const char *end)
+{
+	// Read the table of tokens.
+	size_t count = 0;
+	bool isValid = ReadNumber(it, end, count);
+	vector<string> tokens;
+	tokens.reserve(min<size_t>(count, end - it));
+	for(size_t i = 0; isValid && i < count; ++i)
+	{
+		size_t length = 0;
+		isValid = ReadNumber(it, end, length) && length <= static_cast<size_t>(end - it);
+		if(isValid)
+		{
+			tokens.emplace_back(it, it + length);
+			it += length;
+		}
+	}
+	
+	// Read the nodes. Keep track of the current stack of nodes, and how many more
+	// children each of them has, rather than reading them recursively.
+	vector<pair<DataNode *, size_t>> stack;
+	if(isValid && (isValid = ReadNumber(it, end, count)))
+		stack.emplace_back(&root, count);
+	while(isValid && !stack.empty())
+	{
+		if(!stack.back().second)
+		{
+			stack.pop_back();
+			continue;
+		}
+		--stack.back().second;
+		
+		list<DataNode> &children = stack.back().first->children;
+		children.emplace_back(stack.back().first);
+		DataNode &node = children.back();
+		
+		isValid = ReadNumber(it, end, count);
+		node.tokens.reserve(min<size_t>(count, end - it));
+		for(size_t i = 0; isValid && i < count; ++i)
+		{
+			size_t token = 0;
+			isValid = ReadNumber(it, end, token) && token < tokens.size();
+			if(isValid)
+				node.tokens.push_back(tokens[token]);
+		}
+		if(isValid && (isValid = ReadNumber(it, end, count)))
+			stack.emplace_back(&node, count);
+	}
+	if(!isValid)
+		root.PrintTrace("Error: binary data file is truncated or corrupt:");
+}
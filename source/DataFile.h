@@ -27,6 +27,8 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 // it, it is a "child" of that node. Otherwise, it is a "sibling." Each node is
 // just a collection of one or more tokens that can be interpreted either as
 // strings or as floating point values; see DataNode for more information.
+// A file may also be stored in a compact binary form, with a table of all the
+// distinct tokens followed by the node tree. That is detected automatically.
 class DataFile {
 public:
 	// A DataFile can be loaded either from a file path or an istream.
@@ -41,9 +43,17 @@ public:
 	std::list<DataNode>::const_iterator begin() const;
 	std::list<DataNode>::const_iterator end() const;
 	
+	// Encode all the nodes in this file in the binary form. This is much smaller
+	// and faster to load than the text form if many tokens are repeated, as in
+	// saved games. Comments are not preserved, but all the tokens are.
+	std::string ToBinary() const;
+	// Check whether the given file contents are in the binary form.
+	static bool IsBinary(const std::string &data);
+	
 	
 private:
 	void Load(const char *it, const char *end);
+	void LoadBinary(const char *it, const char *end);
 	
 	
 private:
@@ -34,10 +34,29 @@ DataWriter::DataWriter(const string &path)
 
 
 
+// Constructor for composing the data in memory without saving it to a file.
+// Use GetString() to get the result.
+DataWriter::DataWriter()
+	: before(&indent)
+{
+	out.precision(8);
+}
+
+
+
 // Destructor, which saves the file all in one block.
 DataWriter::~DataWriter()
 {
-	Files::Write(path, out.str());
+	if(!path.empty())
+		Files::Write(path, out.str());
+}
+
+
+
+// Get everything that has been written so far.
+string DataWriter::GetString() const
+{
+	return out.str();
 }
 
 
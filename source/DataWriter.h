@@ -29,10 +29,16 @@ class DataWriter {
 public:
 	// Constructor, specifying the file to write.
 	explicit DataWriter(const std::string &path);
+	// Constructor for composing the data in memory without saving it to a file.
+	// Use GetString() to get the result.
+	DataWriter();
 	// The file is not actually saved until the destructor is called. This makes
 	// it possible to write the whole file in a single chunk.
 	~DataWriter();
 	
+	// Get everything that has been written so far.
+	std::string GetString() const;
+	
 	// The Write() function can take any number of arguments. Each argument is
 	// converted to a token. Arguments may be strings or numeric values.
   template <class A, class ...B>
@@ -12,16 +12,57 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 
 #include "DistanceMap.h"
 
+#include "GameData.h"
 #include "Planet.h"
 #include "PlayerInfo.h"
 #include "Ship.h"
 #include "StellarObject.h"
 #include "System.h"
 
+#include <map>
+#include <mutex>
+#include <tuple>
+
 using namespace std;
 
 
 
+// The cache holds every map that was calculated without a player, keyed by
+// all the parameters that affect its routes: the center and source systems,
+// the count and distance limits, the fuel used by each kind of drive (so a
+// hyperdrive-only map is never confused with a jump drive map), and whether
+// wormholes are used.
+class DistanceMap::Cache {
+public:
+	typedef tuple<const System *, const System *, int, int, int, int, bool> Key;
+	
+	// Limit how many maps are kept, so that the cache cannot grow forever.
+	static const size_t MAX_SIZE = 1024;
+	
+	mutex cacheMutex;
+	map<Key, shared_ptr<vector<Edge>>> maps;
+	// Wormholes that only certain ships can use make a ship's routes depend on
+	// more than just its drives, so those maps cannot be shared.
+	bool checkedWormholes = false;
+	bool hasRestrictedWormholes = false;
+};
+
+DistanceMap::Cache DistanceMap::cache;
+
+
+
+// Distance maps that do not depend on what the player knows are cached, so
+// the same routes are not calculated over and over. The cache must be
+// cleared whenever the links between systems change.
+void DistanceMap::ClearCache()
+{
+	lock_guard<mutex> lock(cache.cacheMutex);
+	cache.maps.clear();
+	cache.checkedWormholes = false;
+}
+
+
+
 // Find paths to the given system. If the given maximum count is above zero,
 // it is a limit on how many systems should be returned. If it is below zero
 // it specifies the maximum distance away that paths should be found.
@@ -76,7 +117,7 @@ DistanceMap::DistanceMap(const Ship &ship, const System *destination)
 // Find out if the given system is reachable.
 bool DistanceMap::HasRoute(const System *system) const
 {
-	return route.count(system);
+	return Find(system);
 }
 
 
@@ -84,8 +125,8 @@ bool DistanceMap::HasRoute(const System *system) const
 // Find out how many days away the given system is.
 int DistanceMap::Days(const System *system) const
 {
-	auto it = route.find(system);
-	return (it == route.end() ? -1 : it->second.days);
+	const Edge *edge = Find(system);
+	return (edge ? edge->days : -1);
 }
 
 
@@ -93,8 +134,8 @@ int DistanceMap::Days(const System *system) const
 // Starting in the given system, what is the next system along the route?
 const System *DistanceMap::Route(const System *system) const
 {
-	auto it = route.find(system);
-	return (it == route.end() ? nullptr : it->second.next);
+	const Edge *edge = Find(system);
+	return (edge ? edge->next : nullptr);
 }
 	
 	
@@ -103,8 +144,10 @@ const System *DistanceMap::Route(const System *system) const
 set<const System *> DistanceMap::Systems() const
 {
 	set<const System *> systems;
-	for(const auto &it : route)
-		systems.insert(it.first);
+	if(route)
+		for(size_t i = 0; i < route->size(); ++i)
+			if((*route)[i].days >= 0 && System::FromIndex(i))
+				systems.insert(System::FromIndex(i));
 	return systems;
 }
 
@@ -120,11 +163,11 @@ const System *DistanceMap::End() const
 
 int DistanceMap::RequiredFuel(const System *system1, const System *system2) const
 {
-	auto it1 = route.find(system1);
-	auto it2 = route.find(system2);
-	if(it1 == route.end() || it2 == route.end())
+	const Edge *edge1 = Find(system1);
+	const Edge *edge2 = Find(system2);
+	if(!edge1 || !edge2)
 		return -1;
-	return abs(it1->second.fuel - it2->second.fuel);
+	return abs(edge1->fuel - edge2->fuel);
 }
 
 
@@ -154,16 +197,13 @@ bool DistanceMap::Edge::operator<(const Edge &other) const
 
 // Depending on the capabilities of the given ship, use hyperspace paths,
 // jump drive paths, or both to find the shortest route. Bail out if the
-// source system or the maximum count is reached.
+// source system or the maximum count is reached. If an identical map has
+// been calculated before, reuse its routes instead.
 void DistanceMap::Init(const Ship *ship)
 {
 	if(!center)
 		return;
 	
-	route[center] = Edge();
-	if(!maxDistance)
-		return;
-	
 	// Check what travel capabilities this ship has. If no ship is given, assume
 	// hyperdrive capability and no jump drive.
 	if(ship)
@@ -174,24 +214,77 @@ void DistanceMap::Init(const Ship *ship)
 		// need to check hyperjump paths at all.
 		if(hyperspaceFuel == jumpFuel)
 			hyperspaceFuel = 0.;
+	}
+	
+	// Maps that depend on what the player knows are never cached.
+	bool isCached = !player;
+	Cache::Key key(center, source, maxCount, maxDistance, hyperspaceFuel, jumpFuel, useWormholes);
+	if(isCached)
+	{
+		lock_guard<mutex> lock(cache.cacheMutex);
+		if(ship && !cache.checkedWormholes)
+		{
+			cache.hasRestrictedWormholes = false;
+			for(const auto &it : GameData::Planets())
+				if(it.second.IsWormhole() && !it.second.IsUnrestricted())
+					cache.hasRestrictedWormholes = true;
+			cache.checkedWormholes = true;
+		}
+		isCached = !(ship && cache.hasRestrictedWormholes);
 		
-		// If this ship has no mode of hyperspace travel, and no local
-		// wormhole to use, bail out.
-		if(!jumpFuel && !hyperspaceFuel)
+		auto it = cache.maps.find(key);
+		if(isCached && it != cache.maps.end())
 		{
-			bool hasWormhole = false;
-			for(const StellarObject &object : ship->GetSystem()->Objects())
-				if(object.GetPlanet() && object.GetPlanet()->IsWormhole())
-				{
-					hasWormhole = true;
-					break;
-				}
-			
-			if(!hasWormhole)
-				return;
+			route = it->second;
+			return;
 		}
 	}
 	
+	// The search is done without holding the lock. If two threads calculate
+	// the same map at once, they will get the same result.
+	Edge unreached;
+	unreached.days = -1;
+	route.reset(new vector<Edge>(System::IndexCount(), unreached));
+	Search(ship);
+	edges = priority_queue<Edge>();
+	
+	if(isCached)
+	{
+		lock_guard<mutex> lock(cache.cacheMutex);
+		if(cache.maps.size() >= Cache::MAX_SIZE)
+			cache.maps.clear();
+		cache.maps[key] = route;
+	}
+}
+
+
+
+// Do the actual pathfinding for Init().
+void DistanceMap::Search(const Ship *ship)
+{
+	if(center->Index() < 0)
+		return;
+	
+	(*route)[center->Index()] = Edge();
+	if(!maxDistance)
+		return;
+	
+	// If this ship has no mode of hyperspace travel, and no local wormhole to
+	// use, bail out.
+	if(ship && !jumpFuel && !hyperspaceFuel)
+	{
+		bool hasWormhole = false;
+		for(const StellarObject &object : ship->GetSystem()->Objects())
+			if(object.GetPlanet() && object.GetPlanet()->IsWormhole())
+			{
+				hasWormhole = true;
+				break;
+			}
+		
+		if(!hasWormhole)
+			return;
+	}
+	
 	// Find the route with lowest fuel use. If multiple routes use the same fuel,
 	// choose the one with the fewest jumps (i.e. using jump drive rather than
 	// hyperdrive). If multiple routes have the same fuel and the same number of
@@ -208,8 +301,11 @@ void DistanceMap::Init(const Ship *ship)
 			break;
 		// Increment the danger and the travel time to include this system. The
 		// fuel cost will be incremented later, because it depends on what type
-		// of travel is being done.
-		top.danger += top.next->Danger();
+		// of travel is being done. How dangerous a system is depends on the
+		// player's reputation, which can change at any time, so only the
+		// player's own maps (which are never cached) use it to break ties.
+		if(player)
+			top.danger += top.next->Danger();
 		++top.days;
 		
 		// Check for wormholes (which cost zero fuel). Wormhole travel should
@@ -223,7 +319,7 @@ void DistanceMap::Init(const Ship *ship)
 					const System *link = source ?
 						object.GetPlanet()->WormholeSource(top.next) :
 						object.GetPlanet()->WormholeDestination(top.next);
-					if(HasBetter(link, top))
+					if(!link || HasBetter(link->Index(), top))
 						continue;
 					
 					// In order to plan travel through a wormhole, it must be
@@ -238,7 +334,7 @@ void DistanceMap::Init(const Ship *ship)
 					if(player && !(player->HasVisited(top.next) && player->HasVisited(link)))
 						continue;
 					
-					Add(link, top);
+					Add(link->Index(), top);
 				}
 		
 		// Bail out if the maximum number of systems is reached.
@@ -255,12 +351,12 @@ void DistanceMap::Init(const Ship *ship)
 bool DistanceMap::Propagate(Edge edge, bool useJump)
 {
 	edge.fuel += (useJump ? jumpFuel : hyperspaceFuel);
-	for(const System *link : (useJump ? edge.next->Neighbors() : edge.next->Links()))
+	for(int link : (useJump ? edge.next->NeighborIndices() : edge.next->LinkIndices()))
 	{
 		// Find out whether we already have a better path to this system, and
 		// check whether this link can be traveled. If this route is being
 		// selected by the player, they are constrained to known routes.
-		if(HasBetter(link, edge) || !CheckLink(edge.next, link, useJump))
+		if(HasBetter(link, edge) || (player && !CheckLink(edge.next, System::FromIndex(link), useJump)))
 			continue;
 		
 		Add(link, edge);
@@ -272,28 +368,44 @@ bool DistanceMap::Propagate(Edge edge, bool useJump)
 
 
 
-// Check if we already have a better path to the given system.
-bool DistanceMap::HasBetter(const System *to, const Edge &edge)
+// Check if we already have a better path to the system with the given index.
+bool DistanceMap::HasBetter(int to, const Edge &edge)
 {
-	auto it = route.find(to);
-	return (it != route.end() && !(it->second < edge));
+	// Systems without an index can never be reached.
+	if(to < 0 || static_cast<size_t>(to) >= route->size())
+		return true;
+	
+	const Edge &existing = (*route)[to];
+	return (existing.days >= 0 && !(existing < edge));
 }
 
 
 
 // Add the given path to the record.
-void DistanceMap::Add(const System *to, Edge edge)
+void DistanceMap::Add(int to, Edge edge)
 {
 	// This is the best path we have found so far to this system, but it is
 	// conceivable that a better one will be found.
-	route[to] = edge;
-	edge.next = to;
+	(*route)[to] = edge;
+	edge.next = System::FromIndex(to);
 	if(maxDistance < 0 || edge.days < maxDistance)
 		edges.emplace(edge);
 }
 
 
 
+// Get the record for the given system, or null if it is not reachable.
+const DistanceMap::Edge *DistanceMap::Find(const System *system) const
+{
+	if(!route || !system || system->Index() < 0 || static_cast<size_t>(system->Index()) >= route->size())
+		return nullptr;
+	
+	const Edge &edge = (*route)[system->Index()];
+	return (edge.days >= 0 ? &edge : nullptr);
+}
+
+
+
 // Check whether the given link is travelable. If no player was given in the
 // constructor then this is always true; otherwise, the player must know
 // that the given link exists.
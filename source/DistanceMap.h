@@ -13,10 +13,11 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #ifndef DISTANCE_MAP_H_
 #define DISTANCE_MAP_H_
 
-#include <map>
+#include <memory>
 #include <queue>
 #include <set>
 #include <utility>
+#include <vector>
 
 class PlayerInfo;
 class Ship;
@@ -30,6 +31,13 @@ class System;
 // but can also travel to any of a system's "neighbors." A distance map can also
 // be used to calculate the shortest route between two systems.
 class DistanceMap {
+public:
+	// Distance maps that do not depend on what the player knows are cached, so
+	// the same routes are not calculated over and over. The cache must be
+	// cleared whenever the links between systems change.
+	static void ClearCache();
+	
+	
 public:
 	// Find paths to the given system. The optional arguments put a limit on how
 	// many systems will be returned and how far away they are allowed to be.
@@ -73,22 +81,31 @@ private:
 		
 		const System *next = nullptr;
 		int fuel = 0;
+		// Systems that have not been reached have a negative number of days.
 		int days = 0;
 		double danger = 0.;
 	};
 	
+	// Storage for the cached routes.
+	class Cache;
+	
 	
 private:
 	// Depending on the capabilities of the given ship, use hyperspace paths,
 	// jump drive paths, or both to find the shortest route. Bail out if the
-	// source system or the maximum count is reached.
+	// source system or the maximum count is reached. If an identical map has
+	// been calculated before, reuse its routes instead.
 	void Init(const Ship *ship = nullptr);
+	// Do the actual pathfinding for Init().
+	void Search(const Ship *ship);
 	// Add the given links to the map. Return false if an end condition is hit.
 	bool Propagate(Edge edge, bool useJump);
-	// Check if we already have a better path to the given system.
-	bool HasBetter(const System *to, const Edge &edge);
+	// Check if we already have a better path to the system with the given index.
+	bool HasBetter(int to, const Edge &edge);
 	// Add the given path to the record.
-	void Add(const System *to, Edge edge);
+	void Add(int to, Edge edge);
+	// Get the record for the given system, or null if it is not reachable.
+	const Edge *Find(const System *system) const;
 	// Check whether the given link is travelable. If no player was given in the
 	// constructor then this is always true; otherwise, the player must know
 	// that the given link exists.
@@ -96,7 +113,12 @@ private:
 	
 	
 private:
-	std::map<const System *, Edge> route;
+	// The route to each system, indexed by System::Index(). The routes are
+	// never modified once the map is complete, so they can be shared between
+	// copies of this map and with the cache.
+	std::shared_ptr<std::vector<Edge>> route;
+	
+	static Cache cache;
 	
 	// Variables only used during construction:
 	std::priority_queue<Edge> edges;
@@ -29,6 +29,7 @@ using namespace std;
 void DrawList::Clear(int step, double zoom)
 {
 	items.clear();
+	velocities.clear();
 	this->step = step;
 	this->zoom = zoom;
 	isHighDPI = (Screen::IsHighResolution() ? zoom > .5 : zoom > 1.);
@@ -110,14 +111,24 @@ bool DrawList::AddSwizzled(const Body &body, int swizzle)
 
 
 
-// Draw all the items in this list.
-void DrawList::Draw() const
+// Draw all the items in this list. If the lag is not zero, each item is
+// drawn that fraction of a step back along its motion.
+void DrawList::Draw(double lag) const
 {
 	SpriteShader::Bind();
 	
 	bool withBlur = Preferences::Has("Render motion blur");
-	for(const SpriteShader::Item &item : items)
-		SpriteShader::Add(item, withBlur);
+	if(!lag)
+		for(const SpriteShader::Item &item : items)
+			SpriteShader::Add(item, withBlur);
+	else
+		for(size_t i = 0; i < items.size(); ++i)
+		{
+			SpriteShader::Item item = items[i];
+			item.position[0] += static_cast<float>(lag * velocities[i].X());
+			item.position[1] += static_cast<float>(lag * velocities[i].Y());
+			SpriteShader::Add(item, withBlur);
+		}
 	
 	SpriteShader::Unbind();
 }
@@ -190,4 +201,5 @@ void DrawList::Push(const Body &body, Point pos, Point blur, double cloak, doubl
 	item.swizzle = swizzle;
 	
 	items.push_back(item);
+	velocities.push_back((body.Velocity() - centerVelocity) * zoom);
 }
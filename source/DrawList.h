@@ -42,8 +42,9 @@ public:
 	bool AddProjectile(const Body &body, const Point &adjustedVelocity, double clip);
 	bool AddSwizzled(const Body &body, int swizzle);
 	
-	// Draw all the items in this list.
-	void Draw() const;
+	// Draw all the items in this list. If the lag is not zero, each item is
+	// drawn that fraction of a step back along its motion.
+	void Draw(double lag = 0.) const;
 	
 	
 private:
@@ -57,6 +58,8 @@ private:
 	double zoom = 1.;
 	bool isHighDPI = false;
 	std::vector<SpriteShader::Item> items;
+	// The velocity of each item relative to the center, in pixels per step.
+	std::vector<Point> velocities;
 	
 	Point center;
 	Point centerVelocity;
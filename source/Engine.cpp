@@ -39,6 +39,7 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #include "PointerShader.h"
 #include "Politics.h"
 #include "Preferences.h"
+#include "Profiler.h"
 #include "Projectile.h"
 #include "Random.h"
 #include "RingShader.h"
@@ -56,6 +57,8 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #include "WrappedText.h"
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cmath>
 #include <string>
 
@@ -160,6 +163,13 @@ namespace {
 	}
 	
 	const double RADAR_SCALE = .025;
+	
+	// The fraction of a step that the game is past the most recent step.
+	double interpolation = 1.;
+	// The number of steps that have been started but not finished.
+	atomic<int> busySteps(0);
+	// Whether the steps that are started from now on will be drawn.
+	bool drawSteps = true;
 }
 
 
@@ -222,6 +232,9 @@ Engine::~Engine()
 	}
 	condition.notify_all();
 	calcThread.join();
+	// If a step was started but never calculated, it is not pending anymore.
+	if(calcTickTock != drawTickTock)
+		--busySteps;
 }
 
 
@@ -387,9 +400,23 @@ void Engine::Place(const list<NPC> &npcs, shared_ptr<Ship> flagship)
 // Wait for the previous calculations (if any) to be done.
 void Engine::Wait()
 {
-	unique_lock<mutex> lock(swapMutex);
-	while(calcTickTock != drawTickTock)
-		condition.wait(lock);
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	{
+		unique_lock<mutex> lock(swapMutex);
+		while(calcTickTock != drawTickTock)
+			condition.wait(lock);
+	}
+	chrono::duration<double> stall = chrono::steady_clock::now() - start;
+	Profiler::Add(Profiler::STALL, stall.count());
+}
+
+
+
+// Check whether the calculation thread is still working on a step. This
+// can be called from the main thread even if there is no engine.
+bool Engine::IsBusy()
+{
+	return busySteps > 0;
 }
 
 
@@ -399,8 +426,10 @@ void Engine::Step(bool isActive)
 {
 	events.swap(eventQueue);
 	eventQueue.clear();
+	isMoving = false;
 	
 	// The calculation thread is now paused, so it is safe to access things.
+	Profiler::Add(Profiler::CALC, calcTime);
 	const shared_ptr<Ship> flagship = player.FlagshipPtr();
 	const StellarObject *object = player.GetStellarObject();
 	if(object)
@@ -551,7 +580,7 @@ void Engine::Step(bool isActive)
 			if(isEnemy || it->IsYours() || it->GetPersonality().IsEscort())
 			{
 				double width = min(it->Width(), it->Height());
-				statuses.emplace_back(it->Position() - center, it->Shields(), it->Hull(),
+				statuses.emplace_back(it->Position() - center, it->Velocity() - centerVelocity, it->Shields(), it->Hull(),
 					max(20., width * .5), isEnemy);
 			}
 		}
@@ -619,6 +648,7 @@ void Engine::Step(bool isActive)
 		
 		targets.push_back({
 			object->Position() - center,
+			-centerVelocity,
 			object->Facing(),
 			object->Radius(),
 			object->GetPlanet()->CanLand() ? Radar::FRIENDLY : Radar::HOSTILE,
@@ -700,6 +730,7 @@ void Engine::Step(bool isActive)
 			double size = (target->Width() + target->Height()) * .35;
 			targets.push_back({
 				target->Position() - center,
+				target->Velocity() - centerVelocity,
 				Angle(45.) + target->Facing(),
 				size,
 				targetType,
@@ -736,7 +767,7 @@ void Engine::Step(bool isActive)
 	{
 		double width = max(target->Width(), target->Height());
 		Point pos = target->Position() - center;
-		statuses.emplace_back(pos, flagship->OutfitScanFraction(), flagship->CargoScanFraction(),
+		statuses.emplace_back(pos, target->Velocity() - centerVelocity, flagship->OutfitScanFraction(), flagship->CargoScanFraction(),
 			10. + max(20., width * .5), 2, Angle(pos).Degrees() + 180.);
 	}
 	// Handle any events that change the selected ships.
@@ -782,6 +813,7 @@ void Engine::Step(bool isActive)
 			double size = (ship->Width() + ship->Height()) * .35;
 			targets.push_back({
 				ship->Position() - center,
+				ship->Velocity() - centerVelocity,
 				Angle(45.) + ship->Facing(),
 				size,
 				Radar::PLAYER,
@@ -800,6 +832,7 @@ void Engine::Step(bool isActive)
 			
 			targets.push_back({
 				offset,
+				minable->Velocity() - centerVelocity,
 				minable->Facing(),
 				.8 * minable->Radius(),
 				minable == flagship->GetTargetAsteroid() ? Radar::SPECIAL : Radar::INACTIVE,
@@ -816,7 +849,10 @@ void Engine::Go()
 		unique_lock<mutex> lock(swapMutex);
 		++step;
 		drawTickTock = !drawTickTock;
+		++busySteps;
+		isDrawing = drawSteps;
 	}
+	isMoving = true;
 	condition.notify_all();
 }
 
@@ -834,16 +870,20 @@ list<ShipEvent> &Engine::Events()
 // Draw a frame.
 void Engine::Draw() const
 {
-	GameData::Background().Draw(center, centerVelocity, zoom);
+	Profiler::Timer timer(Profiler::ENGINE);
+	// Everything that moves is drawn this fraction of a step back along its
+	// motion, relative to the center of the view.
+	double lag = isMoving ? interpolation - 1. : 0.;
+	GameData::Background().Draw(center + lag * centerVelocity, centerVelocity, zoom);
 	static const Set<Color> &colors = GameData::Colors();
 	const Interface *interface = GameData::Interfaces().Get("hud");
 	
 	// Draw any active planet labels.
 	for(const PlanetLabel &label : labels)
-		label.Draw();
+		label.Draw(-lag * zoom * centerVelocity);
 	
-	draw[drawTickTock].Draw();
-	batchDraw[drawTickTock].Draw();
+	draw[drawTickTock].Draw(lag);
+	batchDraw[drawTickTock].Draw(lag);
 	
 	for(const auto &it : statuses)
 	{
@@ -855,7 +895,7 @@ void Engine::Draw() const
 			*colors.Get("overlay hostile hull"),
 			*colors.Get("overlay cargo scan")
 		};
-		Point pos = it.position * zoom;
+		Point pos = (it.position + lag * it.velocity) * zoom;
 		double radius = it.radius * zoom;
 		if(it.outer > 0.)
 			RingShader::Draw(pos, radius + 3., 1.5f, it.outer, color[it.type], 0.f, it.angle);
@@ -904,7 +944,7 @@ void Engine::Draw() const
 		
 		for(int i = 0; i < target.count; ++i)
 		{
-			PointerShader::Draw(target.center * zoom, a.Unit(), 12.f, 14.f, -target.radius * zoom,
+			PointerShader::Draw((target.center + lag * target.velocity) * zoom, a.Unit(), 12.f, 14.f, -target.radius * zoom,
 				Radar::GetColor(target.type));
 			a += da;
 		}
@@ -983,10 +1023,6 @@ void Engine::Draw() const
 	// Draw escort status.
 	escorts.Draw(interface->GetBox("escorts"));
 	
-	// Upload any preloaded sprites that are now available. This is to avoid
-	// filling the entire backlog of sprites before landing on a planet.
-	GameData::Progress();
-	
 	if(Preferences::Has("Show CPU / GPU load"))
 	{
 		string loadString = to_string(lround(load * 100.)) + "% CPU";
@@ -998,6 +1034,27 @@ void Engine::Draw() const
 
 
 
+// Set how far the game is from the most recent step to the next one, as a
+// fraction of a step. Moving objects are drawn that far along the way from
+// where they were in the previous step, so that their motion looks smooth
+// even if the screen refreshes at a different rate than the game steps.
+void Engine::SetInterpolation(double fraction)
+{
+	interpolation = max(0., min(1., fraction));
+}
+
+
+
+// Set whether the steps that are started from now on will be drawn. If not,
+// the calculation thread skips filling in the lists of sprites and radar
+// markers for them, and does not play the engine sounds.
+void Engine::SetDrawing(bool isDrawing)
+{
+	drawSteps = isDrawing;
+}
+
+
+
 // Select the object the player clicked on.
 void Engine::Click(const Point &from, const Point &to, bool hasShift)
 {
@@ -1189,6 +1246,7 @@ void Engine::ThreadEntryPoint()
 			unique_lock<mutex> lock(swapMutex);
 			calcTickTock = drawTickTock;
 		}
+		--busySteps;
 		condition.notify_one();
 	}
 }
@@ -1304,74 +1362,21 @@ void Engine::CalculateStep()
 	for(const shared_ptr<Ship> &it : ships)
 		DoScanning(it);
 	
-	// Draw the objects. Start by figuring out where the view should be centered:
-	Point newCenter = center;
-	Point newCenterVelocity;
-	if(flagship)
-	{
-		newCenter = flagship->Position();
-		newCenterVelocity = flagship->Velocity();
-	}
-	draw[calcTickTock].SetCenter(newCenter, newCenterVelocity);
-	batchDraw[calcTickTock].SetCenter(newCenter);
-	radar[calcTickTock].SetCenter(newCenter);
-	
-	// Populate the radar.
-	FillRadar();
+	// Check if hostile ships have newly appeared.
+	CheckAlarm();
 	
-	// Draw the planets.
-	for(const StellarObject &object : playerSystem->Objects())
-		if(object.HasSprite())
-		{
-			// Don't apply motion blur to very large planets and stars.
-			if(object.Width() >= 280.)
-				draw[calcTickTock].AddUnblurred(object);
-			else
-				draw[calcTickTock].Add(object);
-		}
-	// Draw the asteroids and minables.
-	asteroids.Draw(draw[calcTickTock], newCenter, zoom);
-	// Draw the flotsam.
-	for(const shared_ptr<Flotsam> &it : flotsam)
-		draw[calcTickTock].Add(*it);
-	// Draw the ships. Skip the flagship, then draw it on top of all the others.
-	bool showFlagship = false;
-	for(const shared_ptr<Ship> &ship : ships)
-		if(ship->GetSystem() == playerSystem && ship->HasSprite())
-		{
-			if(ship.get() != flagship)
-			{
-				AddSprites(*ship);
-				if(ship->IsThrusting())
-				{
-					for(const auto &it : ship->Attributes().FlareSounds())
-						if(it.second > 0)
-							Audio::Play(it.first, ship->Position());
-				}
-			}
-			else
-				showFlagship = true;
-		}
-		
-	if(flagship && showFlagship)
-	{
-		AddSprites(*flagship);
-		if(flagship->IsThrusting())
-		{
-			for(const auto &it : flagship->Attributes().FlareSounds())
-				if(it.second > 0)
-					Audio::Play(it.first);
-		}
-	}
-	// Draw the projectiles.
-	for(const Projectile &projectile : projectiles)
-		batchDraw[calcTickTock].Add(projectile, projectile.Clip());
-	// Draw the visuals.
-	for(const Visual &visual : visuals)
-		batchDraw[calcTickTock].Add(visual);
+	// Fill in the lists of what to draw, unless this step is not going to be
+	// drawn. Carried fighters still move along with their carriers, though.
+	if(isDrawing)
+		FillDrawLists();
+	else
+		for(const shared_ptr<Ship> &ship : ships)
+			if(ship->GetSystem() == playerSystem)
+				ship->PositionFighters();
 	
 	// Keep track of how much of the CPU time we are using.
-	loadSum += loadTimer.Time();
+	calcTime = loadTimer.Time();
+	loadSum += calcTime;
 	if(++loadCount == 60)
 	{
 		load = loadSum;
@@ -1909,8 +1914,7 @@ void Engine::FillRadar()
 		radar[calcTickTock].AddViewportBoundary(Screen::BottomRight() / zoom);
 	}
 	
-	// Add ships. Also check if hostile ships have newly appeared.
-	bool hasHostiles = false;
+	// Add ships.
 	for(shared_ptr<Ship> &ship : ships)
 		if(ship->GetSystem() == playerSystem)
 		{
@@ -1926,23 +1930,7 @@ void Engine::FillRadar()
 			double size = sqrt(ship->Width() + ship->Height()) * .14 + .5;
 			
 			radar[calcTickTock].Add(type, ship->Position(), size);
-			
-			// Check if this is a hostile ship.
-			hasHostiles |= (!ship->IsDisabled() && ship->GetGovernment()->IsEnemy()
-				&& ship->GetTargetShip() && ship->GetTargetShip()->IsYours());
 		}
-	// If hostile ships have appeared, play the siren.
-	if(alarmTime)
-		--alarmTime;
-	else if(hasHostiles && !hadHostiles)
-	{
-		if(Preferences::Has("Warning siren"))
-			Audio::Play(Audio::Get("alarm"));
-		alarmTime = 180;
-		hadHostiles = true;
-	}
-	else if(!hasHostiles)
-		hadHostiles = false;
 	
 	// Add projectiles that have a missile strength or homing.
 	for(Projectile &projectile : projectiles)
@@ -1960,6 +1948,107 @@ void Engine::FillRadar()
 
 
 
+// Fill in the lists of sprites and radar markers to draw for this step, and
+// play the engine flare sounds.
+void Engine::FillDrawLists()
+{
+	const Ship *flagship = player.Flagship();
+	const System *playerSystem = player.GetSystem();
+	
+	// Start by figuring out where the view should be centered:
+	Point newCenter = center;
+	Point newCenterVelocity;
+	if(flagship)
+	{
+		newCenter = flagship->Position();
+		newCenterVelocity = flagship->Velocity();
+	}
+	draw[calcTickTock].SetCenter(newCenter, newCenterVelocity);
+	batchDraw[calcTickTock].SetCenter(newCenter, newCenterVelocity);
+	radar[calcTickTock].SetCenter(newCenter);
+	
+	// Populate the radar.
+	FillRadar();
+	
+	// Draw the planets.
+	for(const StellarObject &object : playerSystem->Objects())
+		if(object.HasSprite())
+		{
+			// Don't apply motion blur to very large planets and stars.
+			if(object.Width() >= 280.)
+				draw[calcTickTock].AddUnblurred(object);
+			else
+				draw[calcTickTock].Add(object);
+		}
+	// Draw the asteroids and minables.
+	asteroids.Draw(draw[calcTickTock], newCenter, zoom);
+	// Draw the flotsam.
+	for(const shared_ptr<Flotsam> &it : flotsam)
+		draw[calcTickTock].Add(*it);
+	// Draw the ships. Skip the flagship, then draw it on top of all the others.
+	bool showFlagship = false;
+	for(const shared_ptr<Ship> &ship : ships)
+		if(ship->GetSystem() == playerSystem && ship->HasSprite())
+		{
+			if(ship.get() != flagship)
+			{
+				AddSprites(*ship);
+				if(ship->IsThrusting())
+				{
+					for(const auto &it : ship->Attributes().FlareSounds())
+						if(it.second > 0)
+							Audio::Play(it.first, ship->Position());
+				}
+			}
+			else
+				showFlagship = true;
+		}
+	
+	if(flagship && showFlagship)
+	{
+		AddSprites(*flagship);
+		if(flagship->IsThrusting())
+		{
+			for(const auto &it : flagship->Attributes().FlareSounds())
+				if(it.second > 0)
+					Audio::Play(it.first);
+		}
+	}
+	// Draw the projectiles.
+	for(const Projectile &projectile : projectiles)
+		batchDraw[calcTickTock].Add(projectile, projectile.Clip());
+	// Draw the visuals.
+	for(const Visual &visual : visuals)
+		batchDraw[calcTickTock].Add(visual);
+}
+
+
+
+// Play the warning siren if hostile ships have just appeared.
+void Engine::CheckAlarm()
+{
+	const System *playerSystem = player.GetSystem();
+	bool hasHostiles = false;
+	for(const shared_ptr<Ship> &ship : ships)
+		if(ship->GetSystem() == playerSystem && (ship->Cloaking() < 1. || ship->IsYours()))
+			hasHostiles |= (!ship->IsDisabled() && ship->GetGovernment()->IsEnemy()
+				&& ship->GetTargetShip() && ship->GetTargetShip()->IsYours());
+	
+	if(alarmTime)
+		--alarmTime;
+	else if(hasHostiles && !hadHostiles)
+	{
+		if(Preferences::Has("Warning siren"))
+			Audio::Play(Audio::Get("alarm"));
+		alarmTime = 180;
+		hadHostiles = true;
+	}
+	else if(!hasHostiles)
+		hadHostiles = false;
+}
+
+
+
 // Each ship is drawn as an entire stack of sprites, including hardpoint sprites
 // and engine flares and any fighters it is carrying externally.
 void Engine::AddSprites(const Ship &ship)
@@ -2106,7 +2195,7 @@ void Engine::DoGrudge(const shared_ptr<Ship> &target, const Government *attacker
 
 
 // Constructor for the ship status display rings.
-Engine::Status::Status(const Point &position, double outer, double inner, double radius, int type, double angle)
-	: position(position), outer(outer), inner(inner), radius(radius), type(type), angle(angle)
+Engine::Status::Status(const Point &position, const Point &velocity, double outer, double inner, double radius, int type, double angle)
+	: position(position), velocity(velocity), outer(outer), inner(inner), radius(radius), type(type), angle(angle)
 {
 }
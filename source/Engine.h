@@ -66,6 +66,9 @@ public:
 	
 	// Wait for the previous calculations (if any) to be done.
 	void Wait();
+	// Check whether the calculation thread is still working on a step. This
+	// can be called from the main thread even if there is no engine.
+	static bool IsBusy();
 	// Perform all the work that can only be done while the calculation thread
 	// is paused (for thread safety reasons).
 	void Step(bool isActive);
@@ -78,6 +81,15 @@ public:
 	
 	// Draw a frame.
 	void Draw() const;
+	// Set how far the game is from the most recent step to the next one, as a
+	// fraction of a step. Moving objects are drawn that far along the way from
+	// where they were in the previous step, so that their motion looks smooth
+	// even if the screen refreshes at a different rate than the game steps.
+	static void SetInterpolation(double fraction);
+	// Set whether the steps that are started from now on will be drawn. If not,
+	// the calculation thread skips filling in the lists of sprites and radar
+	// markers for them, and does not play the engine sounds.
+	static void SetDrawing(bool isDrawing);
 	
 	// Select the object the player clicked on.
 	void Click(const Point &from, const Point &to, bool hasShift);
@@ -105,6 +117,8 @@ private:
 	void DoScanning(const std::shared_ptr<Ship> &ship);
 	
 	void FillRadar();
+	void FillDrawLists();
+	void CheckAlarm();
 	
 	void AddSprites(const Ship &ship);
 	
@@ -115,6 +129,7 @@ private:
 	class Target {
 	public:
 		Point center;
+		Point velocity;
 		Angle angle;
 		double radius;
 		int type;
@@ -123,9 +138,10 @@ private:
 	
 	class Status {
 	public:
-		Status(const Point &position, double outer, double inner, double radius, int type, double angle = 0.);
+		Status(const Point &position, const Point &velocity, double outer, double inner, double radius, int type, double angle = 0.);
 		
 		Point position;
+		Point velocity;
 		double outer;
 		double inner;
 		double radius;
@@ -162,6 +178,11 @@ private:
 	bool drawTickTock = false;
 	bool terminate = false;
 	bool wasActive = false;
+	// Whether the calculation thread was started again after the last step. If
+	// not, the game is paused, and nothing should be drawn between steps.
+	bool isMoving = false;
+	// Whether the step that the calculation thread is working on will be drawn.
+	bool isDrawing = true;
 	DrawList draw[2];
 	BatchDrawList batchDraw[2];
 	Radar radar[2];
@@ -216,6 +237,8 @@ private:
 	double load = 0.;
 	int loadCount = 0;
 	double loadSum = 0.;
+	// Time taken by the most recent calculation step, in seconds.
+	double calcTime = 0.;
 };
 
 
@@ -17,6 +17,7 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #include <SDL2/SDL.h>
 
 #if defined _WIN32
+#include <io.h>
 #include <windows.h>
 #endif
 
@@ -79,6 +80,18 @@ namespace {
 		return result;
 	}
 #endif
+	
+	// Make sure everything written to the given file has reached the disk.
+	bool Sync(FILE *file)
+	{
+		if(fflush(file))
+			return false;
+#if defined _WIN32
+		return !_commit(_fileno(file));
+#else
+		return !fsync(fileno(file));
+#endif
+	}
 }
 
 
@@ -479,7 +492,9 @@ string Files::Name(const string &path)
 FILE *Files::Open(const string &path, bool write)
 {
 #if defined _WIN32
-	return _wfopen(ToUTF16(path).c_str(), write ? L"w" : L"rb");
+	// Always use binary mode, so that Windows does not turn each '\n' byte into
+	// "\r\n". That would corrupt binary data, such as compact saved games.
+	return _wfopen(ToUTF16(path).c_str(), write ? L"wb" : L"rb");
 #else
 	return fopen(path.c_str(), write ? "wb" : "rb");
 #endif
@@ -539,6 +554,56 @@ void Files::Write(FILE *file, const string &data)
 
 
 
+// Write the data to a temporary file, make sure it has actually reached the
+// disk, and then replace the given file with it. If anything goes wrong, the
+// original file is left as it was and this returns false.
+bool Files::WriteAtomic(const string &path, const string &data)
+{
+	string temp = path + ".tmp";
+	bool success = false;
+	{
+		File file(temp, true);
+		if(file)
+		{
+			success = (fwrite(data.data(), 1, data.size(), file) == data.size());
+			success &= Sync(file);
+		}
+	}
+	// Read the file back, to be sure that exactly the given bytes were written.
+	if(success)
+		success = (Read(temp) == data);
+	if(!success)
+	{
+		Delete(temp);
+		return false;
+	}
+	
+	Move(temp, path);
+	return true;
+}
+
+
+
+// Add the data to the end of the given file, and make sure it has reached the
+// disk before returning. The file is created if it does not exist.
+bool Files::Append(const string &path, const string &data)
+{
+#if defined _WIN32
+	FILE *file = _wfopen(ToUTF16(path).c_str(), L"ab");
+#else
+	FILE *file = fopen(path.c_str(), "ab");
+#endif
+	if(!file)
+		return false;
+	
+	bool success = (fwrite(data.data(), 1, data.size(), file) == data.size());
+	success &= Sync(file);
+	success &= !fclose(file);
+	return success;
+}
+
+
+
 void Files::LogError(const string &message)
 {
 	lock_guard<mutex> lock(errorMutex);
@@ -62,6 +62,14 @@ public:
 	static std::string Read(FILE *file);
 	static void Write(const std::string &path, const std::string &data);
 	static void Write(FILE *file, const std::string &data);
+	// Write the data to a temporary file, make sure it has actually reached the
+	// disk and reads back unchanged, and then replace the given file with it.
+	// If anything goes wrong, the original file is left as it was and this
+	// returns false.
+	static bool WriteAtomic(const std::string &path, const std::string &data);
+	// Add the data to the end of the given file, and make sure it has reached the
+	// disk before returning. The file is created if it does not exist.
+	static bool Append(const std::string &path, const std::string &data);
 	
 	static void LogError(const std::string &message);
 };
@@ -20,6 +20,7 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #include "DataFile.h"
 #include "DataNode.h"
 #include "DataWriter.h"
+#include "DistanceMap.h"
 #include "Effect.h"
 #include "Files.h"
 #include "FillShader.h"
@@ -32,6 +33,7 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #include "ImageSet.h"
 #include "Interface.h"
 #include "LineShader.h"
+#include "LocationFilter.h"
 #include "Minable.h"
 #include "Mission.h"
 #include "Music.h"
@@ -41,6 +43,7 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #include "Person.h"
 #include "Phrase.h"
 #include "Planet.h"
+#include "PlayerInfo.h"
 #include "PointerShader.h"
 #include "Politics.h"
 #include "Random.h"
@@ -52,9 +55,13 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #include "SpriteShader.h"
 #include "StarField.h"
 #include "StartConditions.h"
+#include "StellarObject.h"
 #include "System.h"
 
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
 #include <iostream>
 #include <map>
 #include <utility>
@@ -126,6 +133,7 @@ bool GameData::BeginLoad(const char * const *argv)
 {
 	bool printShips = false;
 	bool printWeapons = false;
+	int economyDays = 0;
 	bool debugMode = false;
 	for(const char * const *it = argv + 1; *it; ++it)
 	{
@@ -136,6 +144,8 @@ bool GameData::BeginLoad(const char * const *argv)
 				printShips = true;
 			if(arg == "-w" || arg == "--weapons")
 				printWeapons = true;
+			if((arg == "-a" || arg == "--advance-economy") && *(it + 1))
+				economyDays = max(1, atoi(*(it + 1)));
 			if(arg == "-d" || arg == "--debug")
 				debugMode = true;
 			continue;
@@ -161,10 +171,12 @@ bool GameData::BeginLoad(const char * const *argv)
 		// Check that the image set is complete.
 		it.second->Check();
 		// For landscapes, remember all the source files but don't load them yet.
+		// Anything that is not needed to show the menus streams in once the
+		// required sprites are loaded.
 		if(ImageSet::IsDeferred(it.first))
 			deferred[SpriteSet::Get(it.first)] = it.second;
 		else
-			spriteQueue.Add(it.second);
+			spriteQueue.Add(it.second, ImageSet::IsRequired(it.first));
 	}
 	
 	// Generate a catalog of music files.
@@ -205,7 +217,9 @@ bool GameData::BeginLoad(const char * const *argv)
 		PrintShipTable();
 	if(printWeapons)
 		PrintWeaponTable();
-	return !(printShips || printWeapons);
+	if(economyDays)
+		PrintEconomyBenchmark(economyDays);
+	return !(printShips || printWeapons || economyDays);
 }
 
 
@@ -361,6 +375,27 @@ void GameData::Preload(const Sprite *sprite)
 
 
 
+// Make sure the sprites for the player's ships and current system are
+// loaded before the game starts, rather than streaming in afterwards.
+void GameData::RequireSprites(const PlayerInfo &player)
+{
+	for(const shared_ptr<Ship> &ship : player.Ships())
+		if(ship->HasSprite())
+			spriteQueue.Require(ship->GetSprite()->Name());
+	
+	const System *system = player.GetSystem();
+	if(!system)
+		return;
+	
+	for(const StellarObject &object : system->Objects())
+		if(object.HasSprite())
+			spriteQueue.Require(object.GetSprite()->Name());
+	if(system->Haze())
+		spriteQueue.Require(system->Haze()->Name());
+}
+
+
+
 void GameData::FinishLoading()
 {
 	spriteQueue.Finish();
@@ -391,6 +426,10 @@ void GameData::Revert()
 	
 	politics.Reset();
 	purchases.clear();
+	// The restored systems may have different links and trade goods, and the
+	// economy starts out fresh.
+	UpdateNeighbors();
+	System::ResetEconomy();
 }
 
 
@@ -473,7 +512,8 @@ void GameData::WriteEconomy(DataWriter &out)
 
 
 
-void GameData::StepEconomy()
+// Advance the economy by the given number of days.
+void GameData::StepEconomy(int days)
 {
 	// First, apply any purchases the player made. These are deferred until now
 	// so that prices will not change as you are buying or selling goods.
@@ -485,29 +525,9 @@ void GameData::StepEconomy()
 	}
 	purchases.clear();
 	
-	// Then, have each system generate new goods for local use and trade.
-	for(auto &it : systems)
-		it.second.StepEconomy();
-	
-	// Finally, send out the trade goods. This has to be done in a separate step
-	// because otherwise whichever systems trade last would already have gotten
-	// supplied by the other systems.
-	for(auto &it : systems)
-	{
-		System &system = it.second;
-		if(!system.Links().empty())
-			for(const Trade::Commodity &commodity : trade.Commodities())
-			{
-				double supply = system.Supply(commodity.name);
-				for(const System *neighbor : system.Links())
-				{
-					double scale = neighbor->Links().size();
-					if(scale)
-						supply += neighbor->Exports(commodity.name) / scale;
-				}
-				system.SetSupply(commodity.name, supply);
-			}
-	}
+	// Then, have each system generate new goods for local use and trade, and
+	// send out the trade goods.
+	System::StepEconomy(days);
 }
 
 
@@ -545,6 +565,9 @@ void GameData::Change(const DataNode &node)
 		systems.Get(node.Token(1))->Unlink(systems.Get(node.Token(2)));
 	else
 		node.PrintTrace("Invalid \"event\" data:");
+	
+	// Any change may affect which planets and systems a location filter matches.
+	LocationFilter::ClearCache();
 }
 
 
@@ -555,6 +578,12 @@ void GameData::UpdateNeighbors()
 {
 	for(auto &it : systems)
 		it.second.UpdateNeighbors(systems);
+	System::UpdateIndices(systems);
+	Planet::UpdateIndices(planets);
+	// Any routes or location filter matches that were calculated before may
+	// no longer be valid.
+	DistanceMap::ClearCache();
+	LocationFilter::ClearCache();
 }
 
 
@@ -1129,3 +1158,43 @@ void GameData::PrintWeaponTable()
 	}
 	cout.flush();
 }
+
+
+
+// Compare advancing the economy one day at a time to advancing it by many
+// days at once. Both should give the same distribution of supplies.
+void GameData::PrintEconomyBenchmark(int days)
+{
+	cout << "method" << '\t' << "days" << '\t' << "seconds" << '\t'
+		<< "mean" << '\t' << "std_dev" << '\n';
+	for(int batched = 0; batched < 2; ++batched)
+	{
+		System::ResetEconomy();
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		if(batched)
+			StepEconomy(days);
+		else
+			for(int i = 0; i < days; ++i)
+				StepEconomy();
+		chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+		
+		double sum = 0.;
+		double squares = 0.;
+		int count = 0;
+		for(const auto &it : systems)
+			if(it.second.HasTrade())
+				for(const Trade::Commodity &commodity : Commodities())
+				{
+					double supply = it.second.Supply(commodity.name);
+					sum += supply;
+					squares += supply * supply;
+					++count;
+				}
+		double mean = count ? sum / count : 0.;
+		double deviation = count ? sqrt(max(0., squares / count - mean * mean)) : 0.;
+		cout << (batched ? "batched" : "single") << '\t' << days << '\t' << elapsed.count() << '\t'
+			<< mean << '\t' << deviation << '\n';
+	}
+	System::ResetEconomy();
+	cout.flush();
+}
@@ -41,6 +41,7 @@ class Outfit;
 class Person;
 class Phrase;
 class Planet;
+class PlayerInfo;
 class Politics;
 class Ship;
 class Sprite;
@@ -66,6 +67,9 @@ public:
 	// Begin loading a sprite that was previously deferred. Currently this is
 	// done with all landscapes to speed up the program's startup.
 	static void Preload(const Sprite *sprite);
+	// Make sure the sprites for the player's ships and current system are
+	// loaded before the game starts, rather than streaming in afterwards.
+	static void RequireSprites(const PlayerInfo &player);
 	static void FinishLoading();
 	
 	// Get the list of resource sources (i.e. plugin folders).
@@ -77,7 +81,8 @@ public:
 	// Functions for the dynamic economy.
 	static void ReadEconomy(const DataNode &node);
 	static void WriteEconomy(DataWriter &out);
-	static void StepEconomy();
+	// Advance the economy by the given number of days.
+	static void StepEconomy(int days = 1);
 	static void AddPurchase(const System &system, const std::string &commodity, int tons);
 	// Apply the given change to the universe.
 	static void Change(const DataNode &node);
@@ -148,6 +153,7 @@ private:
 	
 	static void PrintShipTable();
 	static void PrintWeaponTable();
+	static void PrintEconomyBenchmark(int days);
 };
 
 
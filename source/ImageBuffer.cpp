@@ -20,6 +20,10 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #include <cstdio>
 #include <vector>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 using namespace std;
 
 namespace {
@@ -132,6 +136,25 @@ void ImageBuffer::ShrinkToHalfSize()
 		unsigned char *aIt = begin + (4 * width) * (2 * y);
 		unsigned char *aEnd = aIt + 4 * 2 * result.width;
 		unsigned char *bIt = begin + (4 * width) * (2 * y + 1);
+#ifdef __SSE2__
+		// Average two output pixels (four input pixels from each row) at a time.
+		// Each channel is widened to 16 bits, so the sums cannot overflow.
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i two = _mm_set1_epi16(2);
+		for( ; aEnd - aIt >= 16; aIt += 16, bIt += 16, out += 8)
+		{
+			__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(aIt));
+			__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bIt));
+			// Sum each column of two pixels, then add adjacent columns together.
+			__m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+			__m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+			lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+			hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+			__m128i sum = _mm_unpacklo_epi64(lo, hi);
+			sum = _mm_srli_epi16(_mm_add_epi16(sum, two), 2);
+			_mm_storel_epi64(reinterpret_cast<__m128i *>(out), _mm_packus_epi16(sum, sum));
+		}
+#endif
 		for( ; aIt != aEnd; aIt += 4, bIt += 4)
 		{
 			for(int channel = 0; channel < 4; ++channel, ++aIt, ++bIt, ++out)
@@ -304,11 +327,40 @@ namespace {
 	
 	void Premultiply(ImageBuffer &buffer, int frame, int additive)
 	{
+#ifdef __SSE2__
+		// Constants for the vectorized loop, which handles four pixels at once.
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i one = _mm_set1_epi16(1);
+		const __m128i alphaMask = _mm_set1_epi32(0xFF000000);
+#endif
 		for(int y = 0; y < buffer.Height(); ++y)
 		{
 			uint32_t *it = buffer.Begin(y, frame);
-			
-			for(uint32_t *end = it + buffer.Width(); it != end; ++it)
+			uint32_t *end = it + buffer.Width();
+#ifdef __SSE2__
+			for( ; end - it >= 4; it += 4)
+			{
+				__m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i *>(it));
+				// Widen each channel to 16 bits and multiply it by its pixel's
+				// alpha. The product of two bytes always fits in 16 bits.
+				__m128i lo = _mm_unpacklo_epi8(value, zero);
+				__m128i hi = _mm_unpackhi_epi8(value, zero);
+				lo = _mm_mullo_epi16(lo, _mm_shufflehi_epi16(_mm_shufflelo_epi16(lo, 0xFF), 0xFF));
+				hi = _mm_mullo_epi16(hi, _mm_shufflehi_epi16(_mm_shufflelo_epi16(hi, 0xFF), 0xFF));
+				// Divide by 255, rounding down: for any x < 65536,
+				// x / 255 == (x + 1 + (x >> 8)) >> 8.
+				lo = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(lo, one), _mm_srli_epi16(lo, 8)), 8);
+				hi = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(hi, one), _mm_srli_epi16(hi, 8)), 8);
+				__m128i result = _mm_andnot_si128(alphaMask, _mm_packus_epi16(lo, hi));
+				// Replace the alpha channel based on the blending mode.
+				if(additive == 1)
+					result = _mm_or_si128(result, _mm_and_si128(_mm_srli_epi32(value, 2), alphaMask));
+				else if(additive != 2)
+					result = _mm_or_si128(result, _mm_and_si128(value, alphaMask));
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(it), result);
+			}
+#endif
+			for( ; it != end; ++it)
 			{
 				uint64_t value = *it;
 				uint64_t alpha = (value & 0xFF000000) >> 24;
@@ -117,6 +117,41 @@ bool ImageSet::IsDeferred(const string &path)
 
 
 
+// Determine whether the given path or name is for a sprite that must be
+// loaded before the game can start, instead of streaming in afterwards.
+bool ImageSet::IsRequired(const string &path)
+{
+	// The menus and the flight interface are drawn right away.
+	if(path.length() >= 3 && !path.compare(0, 3, "ui/"))
+		return true;
+	if(path.length() >= 5 && !path.compare(0, 5, "icon/"))
+		return true;
+	if(path.length() >= 6 && !path.compare(0, 6, "_menu/"))
+		return true;
+	
+	return false;
+}
+
+
+
+// Determine whether the given path or name is for a large sprite that may
+// be drawn at a lower resolution to save memory.
+bool ImageSet::IsReducible(const string &path)
+{
+	if(path.length() >= 5 && !path.compare(0, 5, "land/"))
+		return true;
+	if(path.length() >= 5 && !path.compare(0, 5, "star/"))
+		return true;
+	if(path.length() >= 7 && !path.compare(0, 7, "planet/"))
+		return true;
+	if(path.length() >= 10 && !path.compare(0, 10, "_menu/haze"))
+		return true;
+	
+	return false;
+}
+
+
+
 // Determine whether the given path or name is to a sprite for which a
 // collision mask ought to be generated.
 bool ImageSet::IsMasked(const string &path)
@@ -131,6 +166,21 @@ bool ImageSet::IsMasked(const string &path)
 
 
 
+// Determine whether the given path or name is for a sprite whose size or
+// collision masks affect the game itself, not just what is drawn.
+bool ImageSet::IsShaped(const string &path)
+{
+	// The size of a planet or star determines where ships can land on it.
+	if(path.length() >= 7 && !path.compare(0, 7, "planet/"))
+		return true;
+	if(path.length() >= 5 && !path.compare(0, 5, "star/"))
+		return true;
+	
+	return IsMasked(path);
+}
+
+
+
 // Constructor, optionally specifying the name (for image sets like the
 // plugin icons, whose name can't be determined from the path names).
 ImageSet::ImageSet(const string &name)
@@ -216,13 +266,24 @@ void ImageSet::Load()
 
 
 
-// Create the sprite and upload the image data to the GPU. After this is
-// called, the internal image buffers and mask vector will be cleared, but
-// the paths are saved in case the sprite needs to be loaded again.
+// Give the sprite its dimensions and collision masks. This does not need
+// the GPU, so it is done as soon as the images are loaded, even if the
+// sprite has to wait to be uploaded. The mask vector will be cleared.
+void ImageSet::Shape(Sprite *sprite)
+{
+	if(buffer[0].Pixels())
+		sprite->SetSize(buffer[0].Width(), buffer[0].Height(), buffer[0].Frames());
+	sprite->AddMasks(masks);
+}
+
+
+
+// Upload the image data to the GPU. After this is called, the internal
+// image buffers will be cleared, but the paths are saved in case the
+// sprite needs to be loaded again.
 void ImageSet::Upload(Sprite *sprite)
 {
-	// Load the frames. This will clear the buffers and the mask vector.
+	// Load the frames. This will clear the buffers.
 	sprite->AddFrames(buffer[0], false);
 	sprite->AddFrames(buffer[1], true);
-	sprite->AddMasks(masks);
 }
@@ -40,9 +40,18 @@ public:
 	// Determine whether the given path or name is for a sprite whose loading
 	// should be deferred until needed.
 	static bool IsDeferred(const std::string &path);
+	// Determine whether the given path or name is for a sprite that must be
+	// loaded before the game can start, instead of streaming in afterwards.
+	static bool IsRequired(const std::string &path);
+	// Determine whether the given path or name is for a large sprite that may
+	// be drawn at a lower resolution to save memory.
+	static bool IsReducible(const std::string &path);
 	// Determine whether the given path or name is to a sprite for which a
 	// collision mask ought to be generated.
 	static bool IsMasked(const std::string &path);
+	// Determine whether the given path or name is for a sprite whose size or
+	// collision masks affect the game itself, not just what is drawn.
+	static bool IsShaped(const std::string &path);
 	
 	
 public:
@@ -61,9 +70,13 @@ public:
 	// Load all the frames. This should be called in one of the image-loading
 	// worker threads. This also generates collision masks if needed.
 	void Load();
-	// Create the sprite and upload the image data to the GPU. After this is
-	// called, the internal image buffers and mask vector will be cleared, but
-	// the paths are saved in case the sprite needs to be loaded again.
+	// Give the sprite its dimensions and collision masks. This does not need
+	// the GPU, so it is done as soon as the images are loaded, even if the
+	// sprite has to wait to be uploaded. The mask vector will be cleared.
+	void Shape(Sprite *sprite);
+	// Upload the image data to the GPU. After this is called, the internal
+	// image buffers will be cleared, but the paths are saved in case the
+	// sprite needs to be loaded again.
 	void Upload(Sprite *sprite);
 	
 	
@@ -30,6 +30,7 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #include "PlayerInfo.h"
 #include "Preferences.h"
 #include "Rectangle.h"
+#include "SaveQueue.h"
 #include "ShipyardPanel.h"
 #include "StarField.h"
 #include "UI.h"
@@ -74,6 +75,9 @@ LoadPanel::LoadPanel(PlayerInfo &player, UI &gamePanels)
 	if(player.GetPlanet() && !player.IsDead() && !gamePanels.IsTop(&*gamePanels.Root())
 			&& gamePanels.CanSave())
 		player.Save();
+	// Make sure all the saved games are fully written before listing them, and
+	// that none of them have journals, so they can be copied or deleted.
+	SaveQueue::Compact();
 	UpdateLists();
 }
 
@@ -374,6 +378,9 @@ void LoadPanel::UpdateLists()
 	for(const string &path : fileList)
 	{
 		string fileName = Files::Name(path);
+		// Skip anything that is not a saved game, such as temporary files.
+		if(fileName.length() < 4 || fileName.compare(fileName.length() - 4, 4, ".txt"))
+			continue;
 		// The file name is either "Pilot Name.txt" or "Pilot Name~Date.txt".
 		size_t pos = fileName.find('~');
 		if(pos == string::npos)
@@ -510,7 +517,7 @@ void LoadPanel::DeletePilot()
 	for(const auto &fit : it->second)
 	{
 		string path = Files::Saves() + fit.first;
-		Files::Delete(path);
+		SaveQueue::Delete(path);
 		failed |= Files::Exists(path);
 	}
 	if(failed)
@@ -529,7 +536,7 @@ void LoadPanel::DeleteSave()
 	loadedInfo.Clear();
 	string pilot = selectedPilot;
 	string path = Files::Saves() + selectedFile;
-	Files::Delete(path);
+	SaveQueue::Delete(path);
 	if(Files::Exists(path))
 		GetUI()->Push(new Dialog("Deleting snapshot file failed."));
 	
@@ -23,6 +23,8 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #include "StellarObject.h"
 #include "System.h"
 
+#include <atomic>
+#include <cstdint>
 #include <mutex>
 
 using namespace std;
@@ -105,6 +107,82 @@ namespace {
 		}
 		return true;
 	}
+	
+	// This is incremented every time the cached results become invalid.
+	atomic<int> generation(0);
+	
+	// Possible states of a cached result.
+	const uint8_t UNKNOWN = 0;
+	const uint8_t NO_MATCH = 1;
+	const uint8_t MATCH = 2;
+}
+
+
+
+// For each planet and system, remember whether this filter matches it. Each
+// result is only calculated the first time that it is needed. The results
+// may be read and written from more than one thread, but any thread that
+// calculates a result will get the same answer, so no locking is needed.
+class LocationFilter::Cache {
+public:
+	Cache(bool usesOrigin, const System *origin);
+	
+	// Check a cached result, calculating it if necessary.
+	template <class Type, class Function>
+	bool Get(const Type *object, atomic<uint8_t> *results, int count, Function check);
+	
+	int generation;
+	// If the filter uses the origin system, these results are only valid for
+	// the origin that they were calculated for.
+	bool usesOrigin;
+	const System *origin;
+	unique_ptr<atomic<uint8_t>[]> planets;
+	unique_ptr<atomic<uint8_t>[]> systems;
+	int planetCount;
+	int systemCount;
+};
+
+
+
+LocationFilter::Cache::Cache(bool usesOrigin, const System *origin)
+	: generation(::generation), usesOrigin(usesOrigin), origin(origin),
+	planets(new atomic<uint8_t>[Planet::IndexCount()]), systems(new atomic<uint8_t>[System::IndexCount()]),
+	planetCount(Planet::IndexCount()), systemCount(System::IndexCount())
+{
+	for(int i = 0; i < planetCount; ++i)
+		planets[i].store(UNKNOWN, memory_order_relaxed);
+	for(int i = 0; i < systemCount; ++i)
+		systems[i].store(UNKNOWN, memory_order_relaxed);
+}
+
+
+
+// Check a cached result, calculating it if necessary.
+template <class Type, class Function>
+bool LocationFilter::Cache::Get(const Type *object, atomic<uint8_t> *results, int count, Function check)
+{
+	// Objects that were created after the indices were assigned are not cached.
+	int index = object->Index();
+	if(index < 0 || index >= count)
+		return check();
+	
+	uint8_t result = results[index].load(memory_order_relaxed);
+	if(result == UNKNOWN)
+	{
+		result = check() ? MATCH : NO_MATCH;
+		results[index].store(result, memory_order_relaxed);
+	}
+	return (result == MATCH);
+}
+
+
+
+// Which planets and systems a filter matches is remembered until the galaxy
+// changes. This must be called after anything that might change the
+// results, such as an event modifying a planet or system.
+void LocationFilter::ClearCache()
+{
+	++generation;
 }
 
 
@@ -119,6 +197,7 @@ LocationFilter::LocationFilter(const DataNode &node)
 
 void LocationFilter::Load(const DataNode &node)
 {
+	cache.reset();
 	for(const DataNode &child : node)
 	{
 		// Handle filters that must not match, or must apply to a
@@ -240,29 +319,9 @@ bool LocationFilter::Matches(const Planet *planet, const System *origin) const
 	if(!planet || !planet->GetSystem())
 		return false;
 	
-	// If a ship class was given, do not match planets.
-	if(!shipCategory.empty())
-		return false;
-	
-	if(!governments.empty() && !governments.count(planet->GetGovernment()))
-		return false;
-	
-	if(!planets.empty() && !planets.count(planet))
-		return false;
-	for(const set<string> &attr : attributes)
-		if(!SetsIntersect(attr, planet->Attributes()))
-			return false;
-	
-	for(const LocationFilter &filter : notFilters)
-		if(filter.Matches(planet, origin))
-			return false;
-	
-	// If outfits are specified, make sure they can be bought here.
-	for(const set<const Outfit *> &outfitList : outfits)
-		if(!SetsIntersect(outfitList, planet->Outfitter()))
-			return false;
-	
-	return Matches(planet->GetSystem(), origin, true);
+	shared_ptr<Cache> results = GetCache(origin);
+	return results->Get(planet, results->planets.get(), results->planetCount,
+		[&]() -> bool { return MatchesPlanet(planet, origin); });
 }
 
 
@@ -270,10 +329,12 @@ bool LocationFilter::Matches(const Planet *planet, const System *origin) const
 bool LocationFilter::Matches(const System *system, const System *origin) const
 {
 	// If a ship class was given, do not match systems.
-	if(!shipCategory.empty())
+	if(!shipCategory.empty() || !system)
 		return false;
 	
-	return Matches(system, origin, false);
+	shared_ptr<Cache> results = GetCache(origin);
+	return results->Get(system, results->systems.get(), results->systemCount,
+		[&]() -> bool { return Matches(system, origin, false); });
 }
 
 
@@ -356,6 +417,8 @@ LocationFilter LocationFilter::SetOrigin(const System *origin) const
 	// Revert "distance" parameters to their default.
 	result.originMinDistance = 0;
 	result.originMaxDistance = -1;
+	// The results of the original filter do not apply to this one.
+	result.cache.reset();
 	
 	return result;
 }
@@ -555,3 +618,65 @@ bool LocationFilter::Matches(const System *system, const System *origin, bool di
 	
 	return true;
 }
+
+
+
+// Check if the filter matches the given planet, without using the cache.
+bool LocationFilter::MatchesPlanet(const Planet *planet, const System *origin) const
+{
+	// If a ship class was given, do not match planets.
+	if(!shipCategory.empty())
+		return false;
+	
+	if(!governments.empty() && !governments.count(planet->GetGovernment()))
+		return false;
+	
+	if(!planets.empty() && !planets.count(planet))
+		return false;
+	for(const set<string> &attr : attributes)
+		if(!SetsIntersect(attr, planet->Attributes()))
+			return false;
+	
+	for(const LocationFilter &filter : notFilters)
+		if(filter.Matches(planet, origin))
+			return false;
+	
+	// If outfits are specified, make sure they can be bought here.
+	for(const set<const Outfit *> &outfitList : outfits)
+		if(!SetsIntersect(outfitList, planet->Outfitter()))
+			return false;
+	
+	return Matches(planet->GetSystem(), origin, true);
+}
+
+
+
+// Check if the results of this filter depend on the origin system.
+bool LocationFilter::UsesOrigin() const
+{
+	if(originMaxDistance >= 0)
+		return true;
+	for(const LocationFilter &filter : notFilters)
+		if(filter.UsesOrigin())
+			return true;
+	for(const LocationFilter &filter : neighborFilters)
+		if(filter.UsesOrigin())
+			return true;
+	return false;
+}
+
+
+
+// Get the cache of results for the given origin, replacing the current
+// cache if it is out of date.
+shared_ptr<LocationFilter::Cache> LocationFilter::GetCache(const System *origin) const
+{
+	// The cache pointer may be replaced by another thread at any time.
+	shared_ptr<Cache> results = atomic_load(&cache);
+	if(results && results->generation == generation && (!results->usesOrigin || results->origin == origin))
+		return results;
+	
+	results = make_shared<Cache>(UsesOrigin(), origin);
+	atomic_store(&cache, results);
+	return results;
+}
@@ -14,6 +14,7 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #define LOCATION_FILTER_H_
 
 #include <list>
+#include <memory>
 #include <set>
 #include <string>
 
@@ -32,6 +33,13 @@ class System;
 // have a certain attribute or be owned by a certain government, or be a
 // certain distance away from the current system.
 class LocationFilter {
+public:
+	// Which planets and systems a filter matches is remembered until the galaxy
+	// changes. This must be called after anything that might change the
+	// results, such as an event modifying a planet or system.
+	static void ClearCache();
+	
+	
 public:
 	LocationFilter() = default;
 	// Construct and Load() at the same time.
@@ -69,6 +77,17 @@ private:
 	// only if the filter wasn't looking for planet characteristics or if the
 	// didPlanet argument is set (meaning we already checked those).
 	bool Matches(const System *system, const System *origin, bool didPlanet) const;
+	// Check if the filter matches the given planet, without using the cache.
+	bool MatchesPlanet(const Planet *planet, const System *origin) const;
+	// Check if the results of this filter depend on the origin system.
+	bool UsesOrigin() const;
+	
+	// Storage for the results of matching this filter against each planet and
+	// system in the galaxy.
+	class Cache;
+	// Get the cache of results for the given origin, replacing the current
+	// cache if it is out of date.
+	std::shared_ptr<Cache> GetCache(const System *origin) const;
 	
 	
 private:
@@ -98,6 +117,10 @@ private:
 	std::list<LocationFilter> notFilters;
 	// These filters store all the things the planet or system must border.
 	std::list<LocationFilter> neighborFilters;
+	
+	// Results that have already been calculated. Copies of a filter share the
+	// same results until either one is modified.
+	mutable std::shared_ptr<Cache> cache;
 };
 
 
@@ -423,6 +423,14 @@ bool Mission::IsAtLocation(Location location) const
 
 
 
+// If this mission can only be offered on one particular planet, get it.
+const Planet *Mission::Source() const
+{
+	return source;
+}
+
+
+
 // Information about what you are doing.
 const Planet *Mission::Destination() const
 {
@@ -70,6 +70,8 @@ public:
 	// Find out where this mission is offered.
 	enum Location {SPACEPORT, LANDING, JOB, ASSISTING, BOARDING};
 	bool IsAtLocation(Location location) const;
+	// If this mission can only be offered on one particular planet, get it.
+	const Planet *Source() const;
 	
 	// Information about what you are doing.
 	const Planet *Destination() const;
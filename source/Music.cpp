@@ -17,7 +17,7 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #include <mad.h>
 
 #include <algorithm>
-#include <cstring>
+#include <atomic>
 #include <map>
 
 using namespace std;
@@ -25,13 +25,15 @@ using namespace std;
 namespace {
 	// How many bytes to read from the file at a time:
 	const size_t INPUT_CHUNK = 65536;
-	// How many samples to put in each output block. Because the output is in
-	// stereo, the duration of the sample is half this amount:
-	const size_t OUTPUT_CHUNK = 32768;
 	
 	map<string, string> paths;
+	
+	atomic<int> underruns(0);
 }
 
+const size_t Music::CHUNK_SIZE;
+const size_t Music::DEFAULT_READ_AHEAD;
+
 
 
 void Music::Init(const vector<string> &sources)
@@ -59,10 +61,20 @@ void Music::Init(const vector<string> &sources)
 
 
 
+// Get the number of times any music has run out of decoded data while it
+// was playing, so that silence had to be returned instead.
+int Music::Underruns()
+{
+	return underruns;
+}
+
+
+
 // Music constructor, which starts the decoding thread. Initially, the thread
-// has no file to read, so it will sleep until a file is specified.
-Music::Music()
-	: silence(OUTPUT_CHUNK, 0)
+// has no file to read, so it will sleep until a file is specified. The ring
+// holds the read-ahead plus the block that is currently being played.
+Music::Music(size_t readAhead)
+	: silence(CHUNK_SIZE, 0), buffer((max<size_t>(1, readAhead) + 1) * CHUNK_SIZE, 0)
 {
 	// Don't start the thread until this object is fully constructed.
 	thread = std::thread(&Music::Decode, this);
@@ -108,9 +120,10 @@ void Music::SetSource(const string &name)
 	else
 		nextFile = Files::Open(path);
 	hasNewFile = true;
+	isStreaming = false;
 	
 	// Also clear any decoded data left over from the previous file.
-	next.clear();
+	available = 0;
 	
 	// Notify the decoding thread that it can start.
 	lock.unlock();
@@ -119,28 +132,39 @@ void Music::SetSource(const string &name)
 
 
 
-// Get the next audio buffer to play.
-const vector<int16_t> &Music::NextChunk()
+// Get the next block of CHUNK_SIZE samples. The returned pointer is valid
+// until the next time this function or SetSource() is called, so the data
+// can be handed directly to OpenAL without copying it first.
+const int16_t *Music::NextChunk()
 {
-	// Check whether the "next" buffer is ready.
 	unique_lock<mutex> lock(decodeMutex);
-	if(next.size() < OUTPUT_CHUNK)
-		return silence;
-	
-	// If the next buffer is ready, move a chunk of data into the output buffer.
-	// All output buffers need to be the same size so that we can fade between
-	// two different sources.
-	current.clear();
-	current.insert(current.begin(), next.begin(), next.begin() + OUTPUT_CHUNK);
-	next.erase(next.begin(), next.begin() + OUTPUT_CHUNK);
+	// The block that was returned last time is done with, so the decoder can
+	// now write over it.
+	if(isHolding)
+	{
+		readIndex = (readIndex + CHUNK_SIZE) % buffer.size();
+		isHolding = false;
+	}
+	// Check whether the next block is ready. All blocks need to be the same
+	// size so that we can fade between two different sources.
+	const int16_t *chunk = silence.data();
+	if(available >= CHUNK_SIZE)
+	{
+		// The ring is a whole number of blocks long, so each block is stored
+		// contiguously and can be returned in place.
+		chunk = &buffer[readIndex];
+		available -= CHUNK_SIZE;
+		isHolding = true;
+		isStreaming = true;
+	}
+	else if(isStreaming)
+		++underruns;
 	
 	// Once the lock is unlocked, notify the decoding thread to continue.
 	lock.unlock();
 	condition.notify_all();
 	
-	// Return the buffer.
-	return current;
-	
+	return chunk;
 }
 
 
@@ -148,8 +172,10 @@ const vector<int16_t> &Music::NextChunk()
 // Entry point for the decoding thread.
 void Music::Decode()
 {
-	// This vector will store the input from the file.
-	vector<unsigned char> input(INPUT_CHUNK, 0);
+	// This vector will store the entire contents of the file. MP3 files are
+	// small enough that this is cheaper than reading them a piece at a time,
+	// and it means the decoder never has to wait for the disk.
+	vector<unsigned char> input;
 	// Objects for MP3 decoding:
 	mad_stream stream;
 	mad_frame frame;
@@ -175,99 +201,102 @@ void Music::Decode()
 			hasNewFile = false;
 		}
 		
+		// Read the whole file, then close it.
+		input.clear();
+		while(true)
+		{
+			size_t size = input.size();
+			input.resize(size + INPUT_CHUNK);
+			size_t read = fread(&input.front() + size, 1, INPUT_CHUNK, file);
+			input.resize(size + read);
+			if(read < INPUT_CHUNK)
+				break;
+		}
+		fclose(file);
+		if(input.empty())
+			continue;
+		// The decoder needs a few bytes of padding after the last frame.
+		input.resize(input.size() + MAD_BUFFER_GUARD, 0);
+		
 		// Now, we have a file to read. Initialize the decoder.
 		mad_stream_init(&stream);
 		mad_frame_init(&frame);
 		mad_synth_init(&synth);
+		mad_stream_buffer(&stream, &input.front(), input.size());
+		bool decodedAny = false;
 		
 		// Loop until we are asked to switch files.
 		while(true)
 		{
-			// If the "next" buffer has filled up, wait until it is retrieved.
-			// Generally try to queue up two chunks worth of samples in it, just
-			// in case NextChunk() gets called twice in rapid succession.
+			// Decode the next frame, and check if there is an error.
+			if(mad_frame_decode(&frame, &stream))
+			{
+				// For recoverable errors, keep going.
+				if(MAD_RECOVERABLE(stream.error))
+					continue;
+				// If you get the end of the file, loop around to the beginning,
+				// unless no frame in the file could be decoded at all.
+				if(stream.error == MAD_ERROR_BUFLEN && decodedAny)
+				{
+					decodedAny = false;
+					mad_stream_buffer(&stream, &input.front(), input.size());
+					continue;
+				}
+				break;
+			}
+			decodedAny = true;
+			// Convert the decoded audio into a PCM signal.
+			mad_synth_frame(&synth, &frame);
+			
+			// If the ring buffer is full, wait until a block is retrieved.
+			size_t samples = 2 * synth.pcm.length;
 			unique_lock<mutex> lock(decodeMutex);
-			while(!done && next.size() >= 2 * OUTPUT_CHUNK)
+			while(!done && !hasNewFile
+					&& buffer.size() - available - (isHolding ? CHUNK_SIZE : 0) < samples)
 				condition.wait(lock);
 			// Check if we're done or if we need to switch files.
 			if(done || hasNewFile)
 				break;
+			size_t index = (readIndex + (isHolding ? CHUNK_SIZE : 0) + available) % buffer.size();
 			
-			// The lock can be freed until we start filling the output buffer.
+			// The part of the ring after the decoded data is not touched by
+			// NextChunk(), so it can be filled in without holding the lock.
 			lock.unlock();
 			
-			// See if any input data is left undecoded in the stream. Typically
-			// this is because the last block of input contained a fraction of a
-			// full MP3 frame.
-			size_t remainder = 0;
-			if(stream.next_frame && stream.next_frame < stream.bufend)
-				remainder = stream.bufend - stream.next_frame;
-			if(remainder)
-				memcpy(&input.front(), stream.next_frame, remainder);
+			// If the source is mono, read both output channels from the left input.
+			// Otherwise, read two separate input channels.
+			mad_fixed_t *channels[2] = {
+				synth.pcm.samples[0],
+				synth.pcm.samples[synth.pcm.channels > 1]
+			};
 			
-			// Now, read a chunk of data from the file.
-			size_t read = fread(&input.front() + remainder, 1, INPUT_CHUNK - remainder, file);
-			// If you get the end of the file, loop around to the beginning.
-			if(!read || feof(file))
-				rewind(file);
-			// If there is nothing to decode, return to the top of this loop.
-			if(!(read + remainder))
-				continue;
-			
-			// Hand the input to the stream decoder.
-			mad_stream_buffer(&stream, &input.front(), read + remainder);
-			
-			// Loop through the decoded result for that input block.
-			while(true)
+			// We'll alternate what channel we read from each time through the loop.
+			int channel = 0;
+			for(size_t i = 0; i < samples; ++i)
 			{
-				// Decode the next frame, and check if there is an error.
-				if(mad_frame_decode(&frame, &stream))
-				{
-					// For recoverable errors, keep going.
-					if(MAD_RECOVERABLE(stream.error))
-						continue;
-					else
-						break;
-				}
-				// Convert the decoded audio into a PCM signal.
-				mad_synth_frame(&synth, &frame);
+				// Read the next sample from the next channel.
+				mad_fixed_t sample = *channels[channel]++;
+				channel = !channel;
 				
-				// If the source is mono, read both output channels from the left input.
-				// Otherwise, read two separate input channels.
-				mad_fixed_t *channels[2] = {
-					synth.pcm.samples[0],
-					synth.pcm.samples[synth.pcm.channels > 1]
-				};
-				
-				// For this part, we need access to the output buffer.
-				lock.lock();
-				if(done || hasNewFile)
-					break;
-	
-				// We'll alternate what channel we read from each time through the loop.
-				int channel = 0;
-				for(unsigned i = 0; i < 2 * synth.pcm.length; ++i)
-				{
-					// Read the next sample from the next channel.
-					mad_fixed_t sample = *channels[channel]++;
-					channel = !channel;
-		
-					// Clip and scale the sample to 16 bits.
-					sample += (1L << (MAD_F_FRACBITS - 16));
-					sample = max(-MAD_F_ONE, min(MAD_F_ONE - 1, sample));
-					next.push_back(sample >> (MAD_F_FRACBITS + 1 - 16));
-				}
-				// Now, the "next" buffer can be used by others. In theory, the
-				// NextChunk() function could take what's in that buffer while
-				// we are right in the middle of this decoding cycle.
-				lock.unlock();
+				// Clip and scale the sample to 16 bits.
+				sample += (1L << (MAD_F_FRACBITS - 16));
+				sample = max(-MAD_F_ONE, min(MAD_F_ONE - 1, sample));
+				buffer[index] = sample >> (MAD_F_FRACBITS + 1 - 16);
+				if(++index == buffer.size())
+					index = 0;
 			}
+			
+			// Now, make the new samples available, unless the file was switched
+			// while they were being written.
+			lock.lock();
+			if(done || hasNewFile)
+				break;
+			available += samples;
 		}
 		
 		// Clean up.
 		mad_synth_finish(&synth);
 		mad_frame_finish(&frame);
 		mad_stream_finish(&stream);
-		fclose(file);
 	}
 }
@@ -29,16 +29,35 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 // the decoding thread is not done yet, it returns silence rather than blocking,
 // so the game won't freeze if the music stops for some reason.
 class Music {
+public:
+	// The number of samples in each block. Because the output is in stereo,
+	// the duration of a block is half this many sample periods.
+	static const size_t CHUNK_SIZE = 32768;
+	// By default, the decoder may work this many blocks ahead of the playback.
+	// At 44100 Hz, each block is about 0.37 seconds of music.
+	static const size_t DEFAULT_READ_AHEAD = 4;
+	
+	
 public:
 	static void Init(const std::vector<std::string> &sources);
 	
+	// Get the number of times any music has run out of decoded data while it
+	// was playing, so that silence had to be returned instead.
+	static int Underruns();
+	
 	
 public:
-	Music();
+	// Create a music stream that decodes up to the given number of blocks
+	// ahead of the playback. More read-ahead uses more memory, but makes it
+	// less likely that the music runs out if the decoder is slow.
+	explicit Music(size_t readAhead = DEFAULT_READ_AHEAD);
 	~Music();
 	
 	void SetSource(const std::string &name = "");
-	const std::vector<int16_t> &NextChunk();
+	// Get the next block of CHUNK_SIZE samples. The returned pointer is valid
+	// until the next time this function or SetSource() is called, so the data
+	// can be handed directly to OpenAL without copying it first.
+	const int16_t *NextChunk();
 	
 	
 private:
@@ -47,13 +66,21 @@ private:
 	
 	
 private:
-	// Buffers for storing the decoded audio sample. The "silence" buffer holds
-	// a block of silence to be returned if nothing was read from the file.
+	// Ring buffer of decoded samples, a few blocks long, so the decoder can
+	// work ahead of the playback. Blocks are read out of the ring in place,
+	// and the block that was most recently returned by NextChunk() stays
+	// reserved until the next call. The "silence" buffer holds a block of
+	// silence to be returned if not enough has been decoded yet.
 	std::vector<int16_t> silence;
-	std::vector<int16_t> next;
-	std::vector<int16_t> current;
+	std::vector<int16_t> buffer;
+	size_t readIndex = 0;
+	size_t available = 0;
+	bool isHolding = false;
 	
 	std::string previousPath;
+	// Whether any data has been played from the current file. Running out of
+	// data before then is expected, not an underrun.
+	bool isStreaming = false;
 	// This pointer holds the file for as long as it is owned by the main
 	// thread. When the decode thread takes possession of it, it sets this
 	// pointer to null.
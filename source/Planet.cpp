@@ -32,6 +32,9 @@ namespace {
 	const string WORMHOLE = "wormhole";
 	const string PLANET = "planet";
 	
+	// The number of planets that have been given an index.
+	int indexCount = 0;
+	
 	// Planet attributes in the form "requires: <attribute>" restrict the ability of ships to land
 	// unless the ship has all required attributes.
 	void SetRequiredAttributes(const set<string> &attributes, set<string> &required)
@@ -48,6 +51,26 @@ namespace {
 
 
 
+// Give each planet a dense index, so that code that needs to store a value
+// for every planet can use an array. Planets that already have an index
+// keep it.
+void Planet::UpdateIndices(Set<Planet> &planets)
+{
+	for(auto &it : planets)
+		if(it.second.index < 0)
+			it.second.index = indexCount++;
+}
+
+
+
+// Get the number of planets that have an index.
+int Planet::IndexCount()
+{
+	return indexCount;
+}
+
+
+
 // Load a planet's description from a file.
 void Planet::Load(const DataNode &node)
 {
@@ -244,6 +267,15 @@ const string &Planet::TrueName() const
 
 
 
+// Get this planet's index, or -1 if it was created after the indices were
+// last updated.
+int Planet::Index() const
+{
+	return index;
+}
+
+
+
 // Get the planet's descriptive text.
 const string &Planet::Description() const
 {
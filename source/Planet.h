@@ -14,6 +14,7 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #define PLANET_H_
 
 #include "Sale.h"
+#include "Set.h"
 
 #include <list>
 #include <memory>
@@ -37,6 +38,15 @@ class System;
 // are available, as well as attributes that determine what sort of missions
 // might choose it as a source or destination.
 class Planet {
+public:
+	// Give each planet a dense index, so that code that needs to store a value
+	// for every planet can use an array. Planets that already have an index
+	// keep it.
+	static void UpdateIndices(Set<Planet> &planets);
+	// Get the number of planets that have an index.
+	static int IndexCount();
+	
+	
 public:
 	// Load a planet's description from a file.
 	void Load(const DataNode &node);
@@ -45,6 +55,9 @@ public:
 	const std::string &Name() const;
 	// Get the name used for this planet in the data files.
 	const std::string &TrueName() const;
+	// Get this planet's index, or -1 if it was created after the indices were
+	// last updated.
+	int Index() const;
 	// Get the planet's descriptive text.
 	const std::string &Description() const;
 	// Get the landscape sprite.
@@ -162,6 +175,7 @@ private:
 	mutable std::list<std::shared_ptr<Ship>> defenders;
 	
 	std::vector<const System *> systems;
+	int index = -1;
 };
 
 
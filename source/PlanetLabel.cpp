@@ -106,8 +106,10 @@ PlanetLabel::PlanetLabel(const Point &position, const StellarObject &object, con
 
 
 
-void PlanetLabel::Draw() const
+// Draw the label, shifted by the given offset.
+void PlanetLabel::Draw(const Point &offset) const
 {
+	Point position = this->position + offset;
 	// Draw any active planet labels.
 	const Font &font = FontSet::Get(14);
 	const Font &bigFont = FontSet::Get(18);
@@ -27,7 +27,8 @@ class PlanetLabel {
 public:
 	PlanetLabel(const Point &position, const StellarObject &object, const System *system, double zoom);
 	
-	void Draw() const;
+	// Draw the label, shifted by the given offset.
+	void Draw(const Point &offset = Point()) const;
 	
 	
 private:
@@ -29,8 +29,9 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #include "Planet.h"
 #include "Politics.h"
 #include "Preferences.h"
+#include "Profiler.h"
 #include "Random.h"
-#include "SavedGame.h"
+#include "SaveQueue.h"
 #include "Ship.h"
 #include "ShipEvent.h"
 #include "StartConditions.h"
@@ -39,12 +40,95 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #include "UI.h"
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cmath>
 #include <ctime>
+#include <map>
 #include <sstream>
+#include <thread>
 
 using namespace std;
 
+namespace {
+	// Index of the mission templates that can be offered when landing on a
+	// planet. Missions that name a particular source planet are stored under
+	// that planet, and all others are stored under null. Each entry records
+	// the mission's position in GameData::Missions(), so that the two lists
+	// can be merged back into the same order that the missions were always
+	// checked in. The templates never change once the game data is loaded, so
+	// the index only has to be built once.
+	typedef vector<pair<size_t, const Mission *>> MissionList;
+	const map<const Planet *, MissionList> &MissionIndex()
+	{
+		static map<const Planet *, MissionList> index;
+		static bool isBuilt = false;
+		if(!isBuilt)
+		{
+			size_t position = 0;
+			for(const auto &it : GameData::Missions())
+			{
+				const Mission &mission = it.second;
+				if(!mission.IsAtLocation(Mission::BOARDING) && !mission.IsAtLocation(Mission::ASSISTING))
+					index[mission.Source()].emplace_back(position, &mission);
+				++position;
+			}
+			isBuilt = true;
+		}
+		return index;
+	}
+	
+	
+	
+	double Seconds(chrono::steady_clock::duration elapsed)
+	{
+		return chrono::duration_cast<chrono::nanoseconds>(elapsed).count() * .000000001;
+	}
+	
+	
+	
+	// Instantiate all the given missions, using as many threads as possible.
+	// Each mission gets its own stream of random numbers, so the results are
+	// the same no matter how many threads there are. Anything that this calls
+	// must only use Set::Find() to look up game data, because Set::Get() may
+	// insert into the set.
+	vector<Mission> InstantiateAll(const vector<const Mission *> &offers, const PlayerInfo &player)
+	{
+		vector<Mission> results(offers.size());
+		if(offers.empty())
+			return results;
+		
+		// Draw the seeds from the main generator, and also a seed to reset it
+		// to afterwards, because this thread may work on some of the missions.
+		uint64_t base = (static_cast<uint64_t>(Random::Int()) << 32) | Random::Int();
+		uint64_t resume = (static_cast<uint64_t>(Random::Int()) << 32) | Random::Int();
+		
+		atomic<size_t> next(0);
+		auto work = [&]()
+		{
+			for(size_t i = next++; i < offers.size(); i = next++)
+			{
+				Random::Seed(Random::StreamSeed(base, i));
+				results[i] = offers[i]->Instantiate(player);
+			}
+		};
+		// If all threads share one generator, the missions must be done one at
+		// a time so that they do not reseed each other's streams.
+		size_t threadCount = 0;
+		if(Random::IsThreadLocal())
+			threadCount = min<size_t>(max(1u, thread::hardware_concurrency()), offers.size()) - 1;
+		vector<thread> threads;
+		for(size_t i = 0; i < threadCount; ++i)
+			threads.emplace_back(work);
+		work();
+		for(thread &t : threads)
+			t.join();
+		
+		Random::Seed(resume);
+		return results;
+	}
+}
+
 
 
 // Completely clear all loaded information, to prepare for loading a file or
@@ -106,6 +190,10 @@ void PlayerInfo::New()
 	for(const auto &it : GameData::Events())
 		if(it.second.GetDate())
 			AddEvent(it.second, it.second.GetDate());
+	
+	// The sprites for the starting ships and location should be uploaded
+	// before the game begins, rather than streaming in afterwards.
+	GameData::RequireSprites(*this);
 }
 
 
@@ -113,11 +201,14 @@ void PlayerInfo::New()
 // Load player information from a saved game file.
 void PlayerInfo::Load(const string &path)
 {
-	// Make sure any previously loaded data is cleared.
+	// Make sure any previously loaded data is cleared, and that the file is not
+	// still being written.
 	Clear();
+	SaveQueue::Wait();
 	
 	filePath = path;
-	DataFile file(path);
+	DataFile file;
+	SaveQueue::Read(path, file);
 	
 	hasFullClearance = false;
 	for(const DataNode &child : file)
@@ -300,6 +391,9 @@ void PlayerInfo::Load(const string &path)
 	
 	// Modify the game data with any changes that were loaded from this file.
 	ApplyChanges();
+	// The sprites for this pilot's ships and location should be uploaded
+	// before the game continues, rather than streaming in afterwards.
+	GameData::RequireSprites(*this);
 }
 
 
@@ -330,26 +424,9 @@ void PlayerInfo::Save() const
 	// Remember that this was the most recently saved player.
 	Files::Write(Files::Config() + "recent.txt", filePath + '\n');
 	
-	if(filePath.rfind(".txt") == filePath.length() - 4)
-	{
-		// Only update the backups if this save will have a newer date.
-		SavedGame saved(filePath);
-		if(saved.GetDate() != date.ToString())
-		{
-			string root = filePath.substr(0, filePath.length() - 4);
-			string files[4] = {
-				root + "~~previous-3.txt",
-				root + "~~previous-2.txt",
-				root + "~~previous-1.txt",
-				filePath
-			};
-			for(int i = 0; i < 3; ++i)
-				if(Files::Exists(files[i + 1]))
-					Files::Move(files[i + 1], files[i]);
-		}
-	}
-		
-	Save(filePath);
+	// The backups are rotated when the file is written, but only if the new
+	// save has a different date than the old one.
+	Save(filePath, filePath.rfind(".txt") == filePath.length() - 4);
 }
 
 
@@ -1628,7 +1705,7 @@ int64_t PlayerInfo::GetCondition(const string &name) const
 
 
 // Get mutable access to the player's list of conditions.
-map<string, int64_t> &PlayerInfo::Conditions()
+ConditionsStore &PlayerInfo::Conditions()
 {
 	return conditions;
 }
@@ -1636,7 +1713,7 @@ map<string, int64_t> &PlayerInfo::Conditions()
 
 
 // Access the player's list of conditions.
-const map<string, int64_t> &PlayerInfo::Conditions() const
+const ConditionsStore &PlayerInfo::Conditions() const
 {
 	return conditions;
 }
@@ -2270,28 +2347,55 @@ void PlayerInfo::CreateMissions()
 {
 	boardingMissions.clear();
 	
+	// Only the missions that can be offered anywhere and the ones that can only
+	// be offered on this planet need to be checked.
+	static const MissionList empty;
+	const map<const Planet *, MissionList> &index = MissionIndex();
+	auto anyIt = index.find(nullptr);
+	auto hereIt = planet ? index.find(planet) : index.end();
+	const MissionList &anywhere = (anyIt == index.end()) ? empty : anyIt->second;
+	const MissionList &here = (hereIt == index.end()) ? empty : hereIt->second;
+	
 	// Check for available missions.
 	bool skipJobs = planet && !planet->HasSpaceport();
 	bool hasPriorityMissions = false;
-	for(const auto &it : GameData::Missions())
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	vector<const Mission *> offers;
+	auto ait = anywhere.begin();
+	auto hit = here.begin();
+	while(ait != anywhere.end() || hit != here.end())
 	{
-		if(it.second.IsAtLocation(Mission::BOARDING) || it.second.IsAtLocation(Mission::ASSISTING))
+		// Check the missions in the same order as they appear in the game data,
+		// because that determines the order that they are offered in.
+		bool useHere = (ait == anywhere.end() || (hit != here.end() && hit->first < ait->first));
+		const Mission &mission = *(useHere ? hit++ : ait++)->second;
+		if(skipJobs && mission.IsAtLocation(Mission::JOB))
 			continue;
-		if(skipJobs && it.second.IsAtLocation(Mission::JOB))
+		
+		if(mission.CanOffer(*this))
+			offers.push_back(&mission);
+	}
+	chrono::steady_clock::time_point checked = chrono::steady_clock::now();
+	
+	// Instantiating a mission does not modify the player, so all the missions
+	// that can be offered can be instantiated in parallel. Checking whether they
+	// have failed involves testing the player's conditions, so it must be done
+	// on this thread.
+	vector<Mission> instances = InstantiateAll(offers, *this);
+	for(size_t i = 0; i < offers.size(); ++i)
+	{
+		if(instances[i].HasFailed(*this))
 			continue;
 		
-		if(it.second.CanOffer(*this))
-		{
-			list<Mission> &missions =
-				it.second.IsAtLocation(Mission::JOB) ? availableJobs : availableMissions;
-			
-			missions.push_back(it.second.Instantiate(*this));
-			if(missions.back().HasFailed(*this))
-				missions.pop_back();
-			else if(!it.second.IsAtLocation(Mission::JOB))
-				hasPriorityMissions |= missions.back().HasPriority();
-		}
+		const Mission &mission = *offers[i];
+		list<Mission> &missions =
+			mission.IsAtLocation(Mission::JOB) ? availableJobs : availableMissions;
+		missions.push_back(std::move(instances[i]));
+		if(!mission.IsAtLocation(Mission::JOB))
+			hasPriorityMissions |= missions.back().HasPriority();
 	}
+	Profiler::Report("mission offers", Seconds(checked - start));
+	Profiler::Report("mission instantiation", Seconds(chrono::steady_clock::now() - checked));
 	
 	// If any of the available missions are "priority" missions, no other
 	// special missions will be offered in the spaceport.
@@ -2401,9 +2505,11 @@ void PlayerInfo::Autosave() const
 
 
 
-void PlayerInfo::Save(const string &path) const
+// Save the player to the given path. The file is written in the background,
+// but everything that is saved is copied before this function returns.
+void PlayerInfo::Save(const string &path, bool keepBackups) const
 {
-	DataWriter out(path);
+	DataWriter out;
 	
 	
 	// Basic player information and persistent UI settings:
@@ -2601,6 +2707,9 @@ void PlayerInfo::Save(const string &path) const
 			out.EndChild();
 		}
 	out.EndChild();
+	
+	SaveQueue::Write(path, out.GetString(), date.ToString(), keepBackups,
+		Preferences::Has("Compact saved games"), keepBackups && Preferences::Has("Incremental saves"));
 }
 
 
@@ -15,6 +15,7 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 
 #include "Account.h"
 #include "CargoHold.h"
+#include "ConditionsStore.h"
 #include "DataNode.h"
 #include "Date.h"
 #include "Depreciation.h"
@@ -174,8 +175,8 @@ public:
 	
 	// Access the "condition" flags for this player.
 	int64_t GetCondition(const std::string &name) const;
-	std::map<std::string, int64_t> &Conditions();
-	const std::map<std::string, int64_t> &Conditions() const;
+	ConditionsStore &Conditions();
+	const ConditionsStore &Conditions() const;
 	// Set and check the reputation conditions, which missions and events
 	// can use to modify the player's reputation with other governments.
 	void SetReputationConditions();
@@ -254,7 +255,9 @@ private:
 	void CreateMissions();
 	void StepMissions(UI *ui);
 	void Autosave() const;
-	void Save(const std::string &path) const;
+	// Save the player to the given path. The file is written in the background,
+	// but everything that is saved is copied before this function returns.
+	void Save(const std::string &path, bool keepBackups = false) const;
 	
 	// Check for and apply any punitive actions from planetary security.
 	void Fine(UI *ui);
@@ -304,7 +307,7 @@ private:
 	// its NPCs to be placed before the player lands, and is then cleared.
 	Mission *activeBoardingMission = nullptr;
 	
-	std::map<std::string, int64_t> conditions;
+	ConditionsStore conditions;
 	
 	std::set<const System *> seen;
 	std::set<const System *> visitedSystems;
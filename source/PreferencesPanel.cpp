@@ -52,6 +52,7 @@ namespace {
 	const string REACTIVATE_HELP = "Reactivate first-time help";
 	const string SCROLL_SPEED = "Scroll speed";
 	const string FIGHTER_REPAIR = "Repair fighters in";
+	const string LOW_MEMORY = "Low memory graphics";
 }
 
 
@@ -435,7 +436,10 @@ void PreferencesPanel::DrawSettings()
 		"Performance",
 		"Show CPU / GPU load",
 		"Render motion blur",
+		"Vertical sync",
+		"Pipelined simulation",
 		"Reduce large graphics",
+		LOW_MEMORY,
 		"Draw background haze",
 		"Show hyperspace flash",
 		"",
@@ -446,7 +450,9 @@ void PreferencesPanel::DrawSettings()
 		"Rehire extra crew when lost",
 		SCROLL_SPEED,
 		"Show escort systems on map",
-		"Warning siren"
+		"Warning siren",
+		"Compact saved games",
+		"Incremental saves"
 	};
 	bool isCategory = true;
 	for(const string &setting : SETTINGS)
@@ -536,6 +542,12 @@ void PreferencesPanel::DrawSettings()
 			isOn = true;
 			text = to_string(Preferences::ScrollSpeed());
 		}
+		else if(setting == LOW_MEMORY && isOn && Sprite::ReducedBytes() >= 1000000)
+		{
+			// Report how much GPU memory the reduced sprites are saving. The
+			// setting only affects sprites uploaded after it is turned on.
+			text = to_string(Sprite::ReducedBytes() / 1000000) + " MB saved";
+		}
 		else
 			text = isOn ? "on" : "off";
 		
@@ -0,0 +1,333 @@
+/* Profiler.cpp
+Copyright (c) 2026 by Endless Sky contributors
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#include "Profiler.h"
+
+#include "Audio.h"
+#include "Color.h"
+#include "FillShader.h"
+#include "Font.h"
+#include "FontSet.h"
+#include "Format.h"
+#include "Point.h"
+#include "Preferences.h"
+#include "Screen.h"
+
+#include "gl_header.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <string>
+
+using namespace std;
+
+namespace {
+	// How many frames of history to keep (and to draw in the graph).
+	const int HISTORY = 240;
+	// How many of the most recent frames to average for the text display.
+	const int AVERAGE = 60;
+	// Number of timer queries to cycle through. The result of a query is not
+	// available until the GPU has finished the frame, so it is read back a few
+	// frames later.
+	const int QUERIES = 4;
+	// Scale of the graph, in pixels per millisecond.
+	const double SCALE = 3.;
+	// The time budget for one frame at 60 FPS, in milliseconds.
+	const double BUDGET = 1000. / 60.;
+	
+	const string SECTION_NAMES[Profiler::SECTION_COUNT] = {
+		"calc thread", "calc stall", "engine", "star field", "radar", "panels", "audio", "swap"};
+	
+	class Frame {
+	public:
+		// Time spent in each section, in milliseconds.
+		double section[Profiler::SECTION_COUNT] = {};
+		// Wall clock time from the start of this frame to the start of the next.
+		double total = 0.;
+		// GPU time, if it is known.
+		double gpu = 0.;
+		// The number of game steps that were waiting to be run.
+		int queue = 0;
+	};
+	
+	// Circular buffer of past frames, and the frame currently being recorded.
+	Frame history[HISTORY];
+	int newest = 0;
+	Frame current;
+	chrono::steady_clock::time_point frameStart;
+	bool hasStarted = false;
+	
+	// OpenGL timer queries. If the OpenGL version is too low, they are not used.
+	bool checkedQueries = false;
+	bool hasQueries = false;
+	GLuint queries[QUERIES];
+	int nextQuery = 0;
+	int pendingQueries = 0;
+	bool isQuerying = false;
+	double lastGPU = 0.;
+	
+	// The most recent time taken by each occasional task, in milliseconds.
+	map<string, double> reports;
+	
+	
+	
+	bool IsEnabled()
+	{
+		return Preferences::Has("Show CPU / GPU load");
+	}
+	
+	
+	
+	// Timer queries are part of the core OpenGL API starting in version 3.3.
+	void CheckQueries()
+	{
+		checkedQueries = true;
+		const char *version = reinterpret_cast<const char *>(glGetString(GL_VERSION));
+		if(!version)
+			return;
+		
+		char *end = nullptr;
+		long major = strtol(version, &end, 10);
+		long minor = (end && *end == '.') ? strtol(end + 1, nullptr, 10) : 0;
+		hasQueries = (major > 3 || (major == 3 && minor >= 3));
+		if(hasQueries)
+			glGenQueries(QUERIES, queries);
+	}
+	
+	
+	
+	// Read back any timer queries whose results are available.
+	void ReadQueries()
+	{
+		while(pendingQueries)
+		{
+			GLuint query = queries[(nextQuery + QUERIES - pendingQueries) % QUERIES];
+			GLint isAvailable = 0;
+			glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &isAvailable);
+			if(!isAvailable)
+				break;
+			
+			GLuint64 nanoseconds = 0;
+			glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+			lastGPU = nanoseconds * .000001;
+			--pendingQueries;
+		}
+	}
+	
+	
+	
+	string Milliseconds(double value)
+	{
+		return Format::Decimal(value, 1) + " ms";
+	}
+}
+
+
+
+Profiler::Timer::Timer(Section section)
+	: section(section), start(chrono::steady_clock::now())
+{
+}
+
+
+
+Profiler::Timer::~Timer()
+{
+	chrono::steady_clock::duration elapsed = chrono::steady_clock::now() - start;
+	Add(section, chrono::duration_cast<chrono::nanoseconds>(elapsed).count() * .000000001);
+}
+
+
+
+// Call this before issuing any of the draw commands for a frame. This also
+// stores the times that were recorded for the previous frame.
+void Profiler::BeginFrame()
+{
+	chrono::steady_clock::time_point now = chrono::steady_clock::now();
+	if(hasStarted)
+	{
+		current.total = chrono::duration_cast<chrono::nanoseconds>(now - frameStart).count() * .000001;
+		// The GPU time lags a few frames behind, but that is close enough for
+		// seeing which part of the pipeline is the bottleneck.
+		current.gpu = lastGPU;
+		newest = (newest + 1) % HISTORY;
+		history[newest] = current;
+	}
+	current = Frame();
+	frameStart = now;
+	hasStarted = true;
+	
+	if(!IsEnabled())
+		return;
+	if(!checkedQueries)
+		CheckQueries();
+	// Don't start a new query if all of them are still waiting for results.
+	if(hasQueries && pendingQueries < QUERIES)
+	{
+		glBeginQuery(GL_TIME_ELAPSED, queries[nextQuery]);
+		isQuerying = true;
+	}
+}
+
+
+
+// Call this once all the draw commands have been issued, but before
+// swapping the window's buffers.
+void Profiler::EndFrame()
+{
+	if(isQuerying)
+	{
+		glEndQuery(GL_TIME_ELAPSED);
+		isQuerying = false;
+		nextQuery = (nextQuery + 1) % QUERIES;
+		++pendingQueries;
+	}
+	if(hasQueries)
+		ReadQueries();
+}
+
+
+
+// Add the given time, in seconds, to a section of the current frame.
+void Profiler::Add(Section section, double seconds)
+{
+	current.section[section] += seconds * 1000.;
+}
+
+
+
+// Record how many game steps were still waiting to be run when this frame
+// was drawn.
+void Profiler::SetQueueDepth(int steps)
+{
+	current.queue = steps;
+}
+
+
+
+// Record how long a task that does not happen every frame took, in seconds.
+// The most recent time for each task is listed along with the frame times.
+void Profiler::Report(const string &name, double seconds)
+{
+	reports[name] = seconds * 1000.;
+}
+
+
+
+// Draw the frame time graph, if it is turned on in the preferences.
+void Profiler::Draw()
+{
+	if(!IsEnabled())
+		return;
+	
+	const Font &font = FontSet::Get(14);
+	const Color back(0.f, .6f);
+	const Color dim(.3f, 0.f);
+	const Color medium(.5f, 0.f);
+	const Color bright(.8f, 0.f);
+	const Color cpuColor(.1f, .4f, .1f, 0.f);
+	const Color gpuColor(.5f, .3f, 0.f, 0.f);
+	const Color overColor(.5f, .1f, 0.f, 0.f);
+	
+	// The graph is drawn in the bottom left corner of the screen, with one
+	// column per frame and the newest frame on the right.
+	const double height = 2. * BUDGET * SCALE;
+	Point corner(Screen::Left() + 10., Screen::Bottom() - 10.);
+	FillShader::Fill(corner + Point(HISTORY, -height) * .5, Point(HISTORY, height), back);
+	
+	double average[SECTION_COUNT] = {};
+	double averageTotal = 0.;
+	double averageGPU = 0.;
+	double averageQueue = 0.;
+	double worst = 0.;
+	for(int i = 0; i < HISTORY; ++i)
+	{
+		// Step from the oldest frame to the newest one.
+		const Frame &frame = history[(newest + 1 + i) % HISTORY];
+		if(i >= HISTORY - AVERAGE)
+		{
+			for(int s = 0; s < SECTION_COUNT; ++s)
+				average[s] += frame.section[s] / AVERAGE;
+			averageTotal += frame.total / AVERAGE;
+			averageGPU += frame.gpu / AVERAGE;
+			averageQueue += static_cast<double>(frame.queue) / AVERAGE;
+		}
+		worst = max(worst, frame.total);
+		
+		// The draw thread time is the panels (which include the engine) plus the
+		// audio and the buffer swap. The calculation thread runs in parallel
+		// with drawing.
+		double cpu = frame.section[PANELS] + frame.section[AUDIO] + frame.section[SWAP];
+		double x = corner.X() + i + .5;
+		double total = min(frame.total * SCALE, height);
+		if(total)
+			FillShader::Fill(Point(x, corner.Y() - .5 * total), Point(1., total),
+				frame.total > BUDGET * 1.5 ? overColor : dim);
+		double cpuHeight = min(cpu * SCALE, height);
+		if(cpuHeight)
+			FillShader::Fill(Point(x, corner.Y() - .5 * cpuHeight), Point(1., cpuHeight), cpuColor);
+		double gpuHeight = min(frame.gpu * SCALE, height);
+		if(gpuHeight)
+			FillShader::Fill(Point(x, corner.Y() - gpuHeight), Point(1., 2.), gpuColor);
+	}
+	// Mark the 60 FPS frame budget.
+	FillShader::Fill(corner + Point(.5 * HISTORY, -BUDGET * SCALE), Point(HISTORY, 1.), medium);
+	
+	// List the average time spent in each section over the last second.
+	Point pos = corner + Point(0., -height - 20. * (SECTION_COUNT + 7 + reports.size()));
+	for(int s = 0; s < SECTION_COUNT; ++s)
+	{
+		font.Draw(SECTION_NAMES[s], pos, medium);
+		string value = Milliseconds(average[s]);
+		font.Draw(value, pos + Point(HISTORY - font.Width(value), 0.), bright);
+		pos.Y() += 20.;
+	}
+	string gpu = hasQueries ? Milliseconds(averageGPU) : "not supported";
+	font.Draw("GPU", pos, medium);
+	font.Draw(gpu, pos + Point(HISTORY - font.Width(gpu), 0.), bright);
+	pos.Y() += 20.;
+	string frame = Milliseconds(averageTotal) + " (worst " + Milliseconds(worst) + ")";
+	font.Draw("frame", pos, medium);
+	font.Draw(frame, pos + Point(HISTORY - font.Width(frame), 0.), bright);
+	pos.Y() += 20.;
+	string queue = Format::Decimal(averageQueue, 2) + " steps";
+	font.Draw("step queue", pos, medium);
+	font.Draw(queue, pos + Point(HISTORY - font.Width(queue), 0.), bright);
+	pos.Y() += 20.;
+	
+	// Also show what the audio system did in the most recent frame.
+	Audio::Statistics audio = Audio::GetStatistics();
+	string sounds = to_string(audio.requests) + " (" + to_string(audio.coalesced) + " merged, "
+		+ to_string(audio.dropped) + " dropped)";
+	font.Draw("sounds", pos, medium);
+	font.Draw(sounds, pos + Point(HISTORY - font.Width(sounds), 0.), bright);
+	pos.Y() += 20.;
+	string sources = to_string(audio.sources) + " (" + to_string(audio.recycled) + " recycled)";
+	font.Draw("sources", pos, medium);
+	font.Draw(sources, pos + Point(HISTORY - font.Width(sources), 0.), bright);
+	pos.Y() += 20.;
+	string underruns = to_string(audio.underruns);
+	font.Draw("music underruns", pos, medium);
+	font.Draw(underruns, pos + Point(HISTORY - font.Width(underruns), 0.), bright);
+	pos.Y() += 20.;
+	
+	// List the occasional tasks, such as creating the missions on a planet.
+	for(const auto &it : reports)
+	{
+		string value = Milliseconds(it.second);
+		font.Draw(it.first, pos, medium);
+		font.Draw(value, pos + Point(HISTORY - font.Width(value), 0.), bright);
+		pos.Y() += 20.;
+	}
+}
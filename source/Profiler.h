@@ -0,0 +1,69 @@
+/* Profiler.h
+Copyright (c) 2026 by Endless Sky contributors
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+#include <chrono>
+#include <string>
+
+
+
+// Class for measuring how long each part of a frame takes, both on the CPU and
+// (if OpenGL timer queries are available) on the GPU. The last few seconds of
+// frame times can be drawn as a graph, to help find out whether a stutter comes
+// from the calculation thread, the drawing code, or the graphics card. All of
+// these functions must be called from the main thread.
+class Profiler {
+public:
+	// The parts of a frame that are timed separately. Engine::Draw() includes
+	// the time spent drawing the star field and the radar. The stall is the time
+	// the main thread spent waiting for the calculation thread to finish.
+	enum Section {CALC, STALL, ENGINE, STARFIELD, RADAR, PANELS, AUDIO, SWAP, SECTION_COUNT};
+	
+	// Helper class that adds the time from its creation until it goes out of
+	// scope to the given section of the current frame.
+	class Timer {
+	public:
+		explicit Timer(Section section);
+		~Timer();
+		
+	private:
+		Section section;
+		std::chrono::steady_clock::time_point start;
+	};
+	
+	
+public:
+	// Call this before issuing any of the draw commands for a frame. This also
+	// stores the times that were recorded for the previous frame.
+	static void BeginFrame();
+	// Call this once all the draw commands have been issued, but before
+	// swapping the window's buffers.
+	static void EndFrame();
+	
+	// Add the given time, in seconds, to a section of the current frame.
+	static void Add(Section section, double seconds);
+	// Record how many game steps were still waiting to be run when this frame
+	// was drawn.
+	static void SetQueueDepth(int steps);
+	// Record how long a task that does not happen every frame took, in seconds.
+	// The most recent time for each task is listed along with the frame times.
+	static void Report(const std::string &name, double seconds);
+	
+	// Draw the frame time graph, if it is turned on in the preferences.
+	static void Draw();
+};
+
+
+
+#endif
@@ -15,6 +15,7 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #include "GameData.h"
 #include "LineShader.h"
 #include "PointerShader.h"
+#include "Profiler.h"
 #include "RingShader.h"
 
 #include <cmath>
@@ -83,6 +84,8 @@ void Radar::AddViewportBoundary(const Point &vertex)
 // Draw the radar display at the given coordinates.
 void Radar::Draw(const Point &center, double scale, double radius, double pointerRadius) const
 {
+	Profiler::Timer timer(Profiler::RADAR);
+	
 	// Draw any desired line vectors.
 	for(const Line &line : lines)
 	{
@@ -48,6 +48,34 @@ void Random::Seed(uint64_t seed)
 
 
 
+// Get the seed for one of several independent streams of random numbers.
+// Work that is split across threads can seed each piece of work this way,
+// so that the results do not depend on which thread did what.
+uint64_t Random::StreamSeed(uint64_t base, uint64_t index)
+{
+	// Use the "SplitMix64" finalizer, so that consecutive indices result in
+	// seeds that have nothing in common.
+	uint64_t z = base + (index + 1) * 0x9E3779B97F4A7C15ull;
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	return z ^ (z >> 31);
+}
+
+
+
+// Check if each thread has its own generator. If not, all threads share
+// one generator, so seeding it from one thread affects all the others.
+bool Random::IsThreadLocal()
+{
+#ifndef __linux__
+	return false;
+#else
+	return true;
+#endif
+}
+
+
+
 uint32_t Random::Int()
 {
 #ifndef __linux__
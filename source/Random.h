@@ -25,6 +25,13 @@ public:
 	// Seed the generator (e.g. to make it produce exactly the same random
 	// numbers it produced previously).
 	static void Seed(uint64_t seed);
+	// Get the seed for one of several independent streams of random numbers.
+	// Work that is split across threads can seed each piece of work this way,
+	// so that the results do not depend on which thread did what.
+	static uint64_t StreamSeed(uint64_t base, uint64_t index);
+	// Check if each thread has its own generator. If not, all threads share
+	// one generator, so seeding it from one thread affects all the others.
+	static bool IsThreadLocal();
 	
 	static uint32_t Int();
 	static uint32_t Int(uint32_t modulus);
@@ -0,0 +1,484 @@
+/* SaveQueue.cpp
+Copyright (c) 2026 by Endless Sky contributors
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#include "SaveQueue.h"
+
+#include "DataFile.h"
+#include "DataNode.h"
+#include "DataWriter.h"
+#include "Files.h"
+#include "SavedGame.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace {
+	// After this many journal entries, the journal is merged into a new checkpoint.
+	const int MAX_ENTRIES = 16;
+	
+	class Job {
+	public:
+		string path;
+		string data;
+		string date;
+		bool keepBackups;
+		bool isBinary;
+		bool isIncremental;
+		// A job with this set merges all the journals instead of saving a file.
+		bool isCompaction;
+	};
+	
+	// The text of each section of a saved game, and the root nodes in it.
+	typedef map<string, pair<string, vector<const DataNode *>>> Sections;
+	
+	// Everything that is needed to write a journal entry for a saved game,
+	// instead of writing the whole file.
+	class Checkpoint {
+	public:
+		// The text of each section as of when the whole file was last written.
+		map<string, string> sections;
+		// The size of the text of the saved game, which is what journal entries
+		// are compared to, and the hash and modification time of the file that
+		// was written.
+		size_t size = 0;
+		string hash;
+		time_t timestamp = 0;
+		// The number of entries in the journal, and the most recent save, in
+		// case the journal needs to be merged into the saved game.
+		int entries = 0;
+		Job latest;
+	};
+	
+	mutex queueMutex;
+	deque<Job> jobs;
+	thread worker;
+	bool isWorking = false;
+	
+	// The checkpoint of each saved game that is being written incrementally.
+	// This is only used by the worker thread.
+	map<string, Checkpoint> checkpoints;
+	
+	
+	
+	string JournalPath(const string &path)
+	{
+		return path.substr(0, path.length() - 4) + ".journal";
+	}
+	
+	
+	
+	// Get a 64-bit FNV-1a hash of the given data, to check that a journal
+	// belongs to a particular version of a saved game.
+	string Hash(const string &data)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		for(char c : data)
+			hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+		return to_string(hash);
+	}
+	
+	
+	
+	// Split a saved game into sections, each of which is a run of consecutive
+	// root nodes that begin with the same token. Some nodes refer to the one
+	// before them (e.g. "groups" belongs to the "ship" above it), so the nodes
+	// must stay in exactly the same order. Each section is named by its token
+	// and by how many sections with that token come before it, and the order
+	// of the sections is recorded.
+	void Split(const DataFile &file, Sections &sections, vector<string> &order)
+	{
+		map<string, int> counts;
+		string token;
+		for(const DataNode &node : file)
+		{
+			if(order.empty() || node.Token(0) != token)
+			{
+				token = node.Token(0);
+				order.push_back(token + "#" + to_string(counts[token]++));
+			}
+			sections[order.back()].second.push_back(&node);
+		}
+		for(auto &it : sections)
+		{
+			DataWriter out;
+			for(const DataNode *node : it.second.second)
+				out.Write(*node);
+			it.second.first = out.GetString();
+		}
+	}
+	
+	
+	
+	// Read a saved game along with the most recent entry in its journal. If
+	// there is no journal entry that applies to that saved game, this returns
+	// false without reading anything.
+	bool ReadJournal(const string &path, DataFile &file)
+	{
+		string journalPath = JournalPath(path);
+		if(!Files::Exists(path) || !Files::Exists(journalPath))
+			return false;
+		
+		// Find the last complete entry in the journal, and make sure that the
+		// journal was written for this version of the saved game.
+		string data = Files::Read(path);
+		DataFile journal(journalPath);
+		bool matches = false;
+		const DataNode *entry = nullptr;
+		for(const DataNode &node : journal)
+		{
+			if(node.Token(0) == "checkpoint" && node.Size() >= 2)
+				matches = (node.Token(1) == Hash(data));
+			else if(node.Token(0) == "entry" && node.HasChildren() && (--node.end())->Token(0) == "end")
+				entry = &node;
+		}
+		if(!matches || !entry)
+			return false;
+		
+		// Replace each section of the saved game that is in the journal entry.
+		istringstream in(data);
+		DataFile checkpoint(in);
+		Sections sections;
+		vector<string> checkpointOrder;
+		Split(checkpoint, sections, checkpointOrder);
+		vector<string> order;
+		for(const DataNode &child : *entry)
+		{
+			if(child.Token(0) == "order")
+				for(int i = 1; i < child.Size(); ++i)
+					order.push_back(child.Token(i));
+			else if(child.Token(0) == "section" && child.Size() >= 2)
+			{
+				vector<const DataNode *> &nodes = sections[child.Token(1)].second;
+				nodes.clear();
+				for(const DataNode &node : child)
+					nodes.push_back(&node);
+			}
+		}
+		if(order.empty())
+			return false;
+		
+		DataWriter out;
+		for(const string &key : order)
+			for(const DataNode *node : sections[key].second)
+				out.Write(*node);
+		istringstream merged(out.GetString());
+		file.Load(merged);
+		return true;
+	}
+	
+	
+	
+	// Write the whole saved game, rotating the backups if necessary.
+	bool WriteCheckpoint(const Job &job)
+	{
+		// Write the new file next to the old one before touching anything else,
+		// so that if the write fails, the old file and its backups are intact.
+		string temp = job.path + ".new";
+		if(!Files::WriteAtomic(temp, job.data))
+		{
+			Files::LogError("Error: unable to save \"" + job.path + "\".");
+			return false;
+		}
+		
+		// Only update the backups if this save will have a newer date. The date
+		// of the old save usually comes from the saved game index.
+		if(job.keepBackups && Files::Exists(job.path) && SavedGame(job.path).GetDate() != job.date)
+		{
+			string root = job.path.substr(0, job.path.length() - 4);
+			string files[3] = {
+				root + "~~previous-3.txt",
+				root + "~~previous-2.txt",
+				root + "~~previous-1.txt"
+			};
+			for(int i = 0; i < 2; ++i)
+				if(Files::Exists(files[i + 1]))
+					Files::Move(files[i + 1], files[i]);
+			// The newest backup is a copy of the old file, rather than the file
+			// itself, so that there is always a saved game in place. If the old
+			// file has a journal, the backup is its most recent state.
+			DataFile merged;
+			if(ReadJournal(job.path, merged))
+			{
+				DataWriter out;
+				for(const DataNode &node : merged)
+					out.Write(node);
+				Files::WriteAtomic(files[2], out.GetString());
+			}
+			else
+				Files::Copy(job.path, files[2]);
+		}
+		
+		Files::Move(temp, job.path);
+		// Once the new file is in place, any old journal no longer applies to it.
+		string journal = JournalPath(job.path);
+		if(Files::Exists(journal))
+			Files::Delete(journal);
+		return true;
+	}
+	
+	
+	
+	// Try to save just the sections that have changed since the checkpoint.
+	// If a new checkpoint should be written instead, this returns false.
+	bool WriteJournal(const Job &job, const Sections &sections, const vector<string> &order)
+	{
+		auto cit = checkpoints.find(job.path);
+		if(cit == checkpoints.end())
+			return false;
+		Checkpoint &checkpoint = cit->second;
+		// Make sure nothing else has replaced the saved game since it was written.
+		if(checkpoint.entries >= MAX_ENTRIES || !Files::Exists(job.path)
+				|| Files::Timestamp(job.path) != checkpoint.timestamp)
+			return false;
+		
+		DataWriter out;
+		if(!checkpoint.entries)
+			out.Write("checkpoint", checkpoint.hash);
+		out.Write("entry");
+		out.BeginChild();
+		{
+			out.WriteToken("order");
+			for(const string &key : order)
+				out.WriteToken(key);
+			out.Write();
+			for(const string &key : order)
+			{
+				const auto &section = sections.at(key);
+				auto it = checkpoint.sections.find(key);
+				if(it != checkpoint.sections.end() && it->second == section.first)
+					continue;
+				
+				out.Write("section", key);
+				out.BeginChild();
+				{
+					for(const DataNode *node : section.second)
+						out.Write(*node);
+				}
+				out.EndChild();
+			}
+			// An entry is only used if it is complete.
+			out.Write("end");
+		}
+		out.EndChild();
+		
+		// If most of the file has changed, it is better to write all of it.
+		string entry = out.GetString();
+		if(2 * entry.size() > checkpoint.size)
+			return false;
+		if(!Files::Append(JournalPath(job.path), entry))
+			return false;
+		
+		++checkpoint.entries;
+		checkpoint.latest = job;
+		return true;
+	}
+	
+	
+	
+	void Save(Job &job)
+	{
+		// The saved game is parsed here, rather than on the main thread, to
+		// convert it to the binary format if requested, to summarize it for the
+		// load panel, and to find out what has changed since the last save.
+		istringstream in(job.data);
+		DataFile file(in);
+		Sections sections;
+		vector<string> order;
+		if(job.isIncremental)
+		{
+			Split(file, sections, order);
+			if(WriteJournal(job, sections, order))
+			{
+				SavedGame::Remember(job.path, file);
+				return;
+			}
+		}
+		
+		size_t textSize = job.data.size();
+		if(job.isBinary)
+			job.data = file.ToBinary();
+		checkpoints.erase(job.path);
+		if(!WriteCheckpoint(job))
+			return;
+		
+		SavedGame::Remember(job.path, file);
+		if(job.isIncremental)
+		{
+			Checkpoint &checkpoint = checkpoints[job.path];
+			for(const auto &it : sections)
+				checkpoint.sections[it.first] = it.second.first;
+			checkpoint.size = textSize;
+			checkpoint.hash = Hash(job.data);
+			checkpoint.timestamp = Files::Timestamp(job.path);
+		}
+	}
+	
+	
+	
+	// Write the most recent version of every saved game that has a journal.
+	// That includes any journals on disk that this session did not write,
+	// e.g. because the game quit before it could merge them.
+	void Compact()
+	{
+		for(auto it = checkpoints.begin(); it != checkpoints.end(); )
+		{
+			if(it->second.entries)
+			{
+				Job job = it->second.latest;
+				job.isIncremental = false;
+				it = checkpoints.erase(it);
+				Save(job);
+			}
+			else
+				++it;
+		}
+		
+		for(const string &path : Files::List(Files::Saves()))
+		{
+			if(path.length() < 8 || path.compare(path.length() - 8, 8, ".journal"))
+				continue;
+			
+			// A journal that no longer applies to any saved game can just be
+			// deleted. Otherwise, it is merged into a new copy of the file, in
+			// the same format as the file it belongs to.
+			string savePath = path.substr(0, path.length() - 8) + ".txt";
+			DataFile file;
+			if(!ReadJournal(savePath, file))
+			{
+				Files::Delete(path);
+				continue;
+			}
+			DataWriter out;
+			for(const DataNode &node : file)
+				out.Write(node);
+			bool isBinary = DataFile::IsBinary(Files::Read(savePath));
+			Job job{savePath, out.GetString(), "", false, isBinary, false, false};
+			Save(job);
+		}
+	}
+	
+	
+	
+	// Write the queued files until there are none left.
+	void Work()
+	{
+		while(true)
+		{
+			Job job;
+			{
+				lock_guard<mutex> lock(queueMutex);
+				if(jobs.empty())
+				{
+					isWorking = false;
+					return;
+				}
+				job = std::move(jobs.front());
+				jobs.pop_front();
+			}
+			if(job.isCompaction)
+				Compact();
+			else
+				Save(job);
+		}
+	}
+	
+	
+	
+	void Add(const Job &job)
+	{
+		lock_guard<mutex> lock(queueMutex);
+		jobs.push_back(job);
+		if(isWorking)
+			return;
+		
+		// The previous worker has finished (or is just about to), so start a new one.
+		if(worker.joinable())
+			worker.join();
+		isWorking = true;
+		worker = thread(Work);
+	}
+}
+
+
+
+// Queue the given text to be saved to the given path. The date is the date
+// in the saved game. If backups are kept, the previous three versions of
+// the file (with different dates) are kept as "~~previous-N.txt" files.
+// If isBinary is set, the text is converted to the binary data format. If
+// isIncremental is set, only the changes may be written to a journal.
+void SaveQueue::Write(const string &path, const string &data, const string &date, bool keepBackups, bool isBinary, bool isIncremental)
+{
+	Add(Job{path, data, date, keepBackups, isBinary, isIncremental, false});
+}
+
+
+
+// Wait until everything that has been queued is written. Call this before
+// reading any saved games.
+void SaveQueue::Wait()
+{
+	if(worker.joinable())
+		worker.join();
+}
+
+
+
+// Merge any journals into the saved games they belong to, and wait until
+// that is done. Call this before copying or deleting saved games, and
+// before quitting.
+void SaveQueue::Compact()
+{
+	Add(Job{"", "", "", false, false, false, true});
+	Wait();
+}
+
+
+
+// Read a saved game, including the most recent journal entry if it has one.
+void SaveQueue::Read(const string &path, DataFile &file)
+{
+	if(!ReadJournal(path, file))
+		file.Load(path);
+}
+
+
+
+// Delete a saved game, along with its journal if it has one.
+void SaveQueue::Delete(const string &path)
+{
+	Wait();
+	Files::Delete(path);
+	string journalPath = JournalPath(path);
+	if(Files::Exists(journalPath))
+		Files::Delete(journalPath);
+}
+
+
+
+// Get the last time a saved game or its journal was modified.
+time_t SaveQueue::Timestamp(const string &path)
+{
+	time_t timestamp = Files::Timestamp(path);
+	string journalPath = JournalPath(path);
+	if(Files::Exists(journalPath))
+		timestamp = max(timestamp, Files::Timestamp(journalPath));
+	return timestamp;
+}
@@ -0,0 +1,60 @@
+/* SaveQueue.h
+Copyright (c) 2026 by Endless Sky contributors
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#ifndef SAVE_QUEUE_H_
+#define SAVE_QUEUE_H_
+
+#include <ctime>
+#include <string>
+
+class DataFile;
+
+
+
+// Class for writing saved games in a background thread, so that the game does
+// not freeze while a large save file is being written to the disk. The player
+// data is turned into text on the main thread, so that the game state can keep
+// changing while it is written. Files are written in the order they were
+// queued, and each one replaces the old file only once it is complete.
+//
+// A saved game can also be written incrementally. Then, the whole file is only
+// written occasionally, as a "checkpoint." In between, each save appends an
+// entry to a journal file, with just the sections of the file (runs of root
+// nodes with the same first token, e.g. one "ship" or the "conditions") that
+// differ from the checkpoint.
+class SaveQueue {
+public:
+	// Queue the given text to be saved to the given path. The date is the date
+	// in the saved game. If backups are kept, the previous three versions of
+	// the file (with different dates) are kept as "~~previous-N.txt" files.
+	// If isBinary is set, the text is converted to the binary data format. If
+	// isIncremental is set, only the changes may be written to a journal.
+	static void Write(const std::string &path, const std::string &data, const std::string &date, bool keepBackups, bool isBinary = false, bool isIncremental = false);
+	// Wait until everything that has been queued is written. Call this before
+	// reading any saved games.
+	static void Wait();
+	// Merge any journals into the saved games they belong to, and wait until
+	// that is done. Call this before copying or deleting saved games, and
+	// before quitting.
+	static void Compact();
+	
+	// Read a saved game, including the most recent journal entry if it has one.
+	static void Read(const std::string &path, DataFile &file);
+	// Delete a saved game, along with its journal if it has one.
+	static void Delete(const std::string &path);
+	// Get the last time a saved game or its journal was modified.
+	static std::time_t Timestamp(const std::string &path);
+};
+
+
+
+#endif
@@ -14,12 +14,33 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 
 #include "DataFile.h"
 #include "DataNode.h"
+#include "DataWriter.h"
 #include "Date.h"
+#include "Files.h"
 #include "Format.h"
+#include "SaveQueue.h"
 #include "SpriteSet.h"
 
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <utility>
+
 using namespace std;
 
+namespace {
+	// The summaries of all the saved games that are known, keyed by file name,
+	// along with each file's modification time when it was summarized.
+	mutex indexMutex;
+	map<string, pair<time_t, SavedGame>> summaries;
+	bool isIndexLoaded = false;
+	
+	string IndexPath()
+	{
+		return Files::Saves() + "index.dat";
+	}
+}
+
 
 
 SavedGame::SavedGame(const string &path)
@@ -29,13 +50,62 @@ SavedGame::SavedGame(const string &path)
 
 
 
+// Load the summary of the given saved game, from the index if possible.
+// This is safe to call from any thread.
 void SavedGame::Load(const string &path)
 {
 	Clear();
-	DataFile file(path);
-	if(file.begin() != file.end())
-		this->path = path;
+	if(!Files::Exists(path))
+		return;
+	
+	time_t timestamp = SaveQueue::Timestamp(path);
+	string name = Files::Name(path);
+	{
+		lock_guard<mutex> lock(indexMutex);
+		LoadIndex();
+		auto it = summaries.find(name);
+		if(it != summaries.end() && it->second.first == timestamp)
+		{
+			*this = it->second.second;
+			this->path = path;
+			return;
+		}
+	}
+	
+	DataFile file;
+	SaveQueue::Read(path, file);
+	if(file.begin() == file.end())
+		return;
 	
+	this->path = path;
+	Read(file);
+	
+	lock_guard<mutex> lock(indexMutex);
+	summaries[name] = make_pair(timestamp, *this);
+	SaveIndex();
+}
+
+
+
+// Summarize the given data, which has just been saved to the given path,
+// and store that summary in the index. This is safe to call from any thread.
+void SavedGame::Remember(const string &path, const DataFile &file)
+{
+	SavedGame game;
+	game.path = path;
+	game.Read(file);
+	
+	lock_guard<mutex> lock(indexMutex);
+	LoadIndex();
+	summaries[Files::Name(path)] = make_pair(SaveQueue::Timestamp(path), game);
+	SaveIndex();
+}
+
+
+
+// Read the summary from the given saved game data.
+void SavedGame::Read(const DataFile &file)
+{
 	for(const DataNode &node : file)
 	{
 		if(node.Token(0) == "pilot" && node.Size() >= 3)
@@ -55,14 +125,14 @@ void SavedGame::Load(const string &path)
 					break;
 				}
 		}
-		else if(node.Token(0) == "ship" && !shipSprite)
+		else if(node.Token(0) == "ship" && shipSprite.empty())
 		{
 			for(const DataNode &child : node)
 			{
 				if(child.Token(0) == "name" && child.Size() >= 2)
 					shipName = child.Token(1);
 				else if(child.Token(0) == "sprite" && child.Size() >= 2)
-					shipSprite = SpriteSet::Get(child.Token(1));
+					shipSprite = child.Token(1);
 			}
 		}
 	}
@@ -70,6 +140,86 @@ void SavedGame::Load(const string &path)
 
 
 
+// Load the index file, if it has not been loaded yet. The caller must hold
+// the lock on the index.
+void SavedGame::LoadIndex()
+{
+	if(isIndexLoaded)
+		return;
+	isIndexLoaded = true;
+	
+	DataFile file(IndexPath());
+	for(const DataNode &node : file)
+	{
+		if(node.Size() < 2)
+			continue;
+		
+		auto &entry = summaries[node.Token(0)];
+		entry.first = static_cast<time_t>(node.Value(1));
+		SavedGame &game = entry.second;
+		for(const DataNode &child : node)
+		{
+			if(child.Size() < 2)
+				continue;
+			
+			const string &value = child.Token(1);
+			if(child.Token(0) == "name")
+				game.name = value;
+			else if(child.Token(0) == "credits")
+				game.credits = value;
+			else if(child.Token(0) == "date")
+				game.date = value;
+			else if(child.Token(0) == "system")
+				game.system = value;
+			else if(child.Token(0) == "planet")
+				game.planet = value;
+			else if(child.Token(0) == "sprite")
+				game.shipSprite = value;
+			else if(child.Token(0) == "ship")
+				game.shipName = value;
+		}
+	}
+}
+
+
+
+// Write the index to disk, leaving out any saved games that no longer exist.
+// The caller must hold the lock on the index.
+void SavedGame::SaveIndex()
+{
+	DataWriter out;
+	for(auto it = summaries.begin(); it != summaries.end(); )
+	{
+		if(!Files::Exists(Files::Saves() + it->first))
+		{
+			it = summaries.erase(it);
+			continue;
+		}
+		
+		const SavedGame &game = it->second.second;
+		out.Write(it->first, static_cast<int64_t>(it->second.first));
+		out.BeginChild();
+		{
+			out.Write("name", game.name);
+			out.Write("credits", game.credits);
+			out.Write("date", game.date);
+			if(!game.system.empty())
+				out.Write("system", game.system);
+			if(!game.planet.empty())
+				out.Write("planet", game.planet);
+			if(!game.shipSprite.empty())
+				out.Write("sprite", game.shipSprite);
+			if(!game.shipName.empty())
+				out.Write("ship", game.shipName);
+		}
+		out.EndChild();
+		++it;
+	}
+	Files::WriteAtomic(IndexPath(), out.GetString());
+}
+
+
+
 const string &SavedGame::Path() const
 {
 	return path;
@@ -95,7 +245,7 @@ void SavedGame::Clear()
 	system.clear();
 	planet.clear();
 	
-	shipSprite = nullptr;
+	shipSprite.clear();
 	shipName.clear();
 }
 
@@ -136,9 +286,10 @@ const string &SavedGame::GetPlanet() const
 
 
 
+// Get the flagship's sprite. This must only be called from the main thread.
 const Sprite *SavedGame::ShipSprite() const
 {
-	return shipSprite;
+	return shipSprite.empty() ? nullptr : SpriteSet::Get(shipSprite);
 }
 
 
@@ -15,6 +15,7 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 
 #include <string>
 
+class DataFile;
 class Sprite;
 
 
@@ -23,13 +24,22 @@ class Sprite;
 // information necessary from the file to display it in the "Load Game" panel,
 // without doing all the complicated parsing that PlayerInfo does. This is so
 // that we only need to have one PlayerInfo instance, and there does not need
-// to be logic for copying one PlayerInfo into another.
+// to be logic for copying one PlayerInfo into another. The summary of each
+// saved game is also stored in an index file in the saves folder, along with
+// the file's modification time, so a file that has not changed since it was
+// last summarized does not need to be read at all.
 class SavedGame {
 public:
 	SavedGame() = default;
 	explicit SavedGame(const std::string &path);
 	
+	// Load the summary of the given saved game, from the index if possible.
+	// This is safe to call from any thread.
 	void Load(const std::string &path);
+	// Summarize the given data, which has just been saved to the given path,
+	// and store that summary in the index. This is safe to call from any thread.
+	static void Remember(const std::string &path, const DataFile &file);
+	
 	const std::string &Path() const;
 	bool IsLoaded() const;
 	void Clear();
@@ -41,10 +51,20 @@ public:
 	const std::string &GetSystem() const;
 	const std::string &GetPlanet() const;
 	
+	// Get the flagship's sprite. This must only be called from the main thread.
 	const Sprite *ShipSprite() const;
 	const std::string &ShipName() const;
 	
 	
+private:
+	// Read the summary from the given saved game data.
+	void Read(const DataFile &file);
+	// Load the index file, if it has not been loaded yet, or write it to disk.
+	// The caller must hold the lock on the index.
+	static void LoadIndex();
+	static void SaveIndex();
+	
+	
 private:
 	std::string path;
 	
@@ -55,7 +75,7 @@ private:
 	std::string system;
 	std::string planet;
 	
-	const Sprite *shipSprite = nullptr;
+	std::string shipSprite;
 	std::string shipName;
 };
 
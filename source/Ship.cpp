@@ -340,10 +340,12 @@ void Ship::FinishLoading(bool isNewInstance)
 	// All copies of this ship should save pointers to the "explosion" weapon
 	// definition stored safely in the ship model, which will not be destroyed
 	// until GameData is when the program quits. Also copy other attributes of
-	// the base model if no overrides were given.
-	if(GameData::Ships().Has(modelName))
+	// the base model if no overrides were given. This may run on several
+	// threads at once while missions are instantiated, so it must only look up
+	// existing entries in the game data, never create them.
+	const Ship *model = GameData::Ships().Find(modelName);
+	if(model)
 	{
-		const Ship *model = GameData::Ships().Get(modelName);
 		explosionWeapon = &model->BaseAttributes();
 		if(pluralModelName.empty())
 			pluralModelName = model->pluralModelName;
@@ -532,9 +534,10 @@ void Ship::FinishLoading(bool isNewInstance)
 		Recharge(true);
 	
 	// Add a default "launch effect" to any internal bays if this ship is crewed (i.e. pressurized).
+	const Effect *basicLaunch = GameData::Effects().Find("basic launch");
 	for(Bay &bay : bays)
-		if(bay.side == Bay::INSIDE && bay.launchEffects.empty() && Crew())
-			bay.launchEffects.emplace_back(GameData::Effects().Get("basic launch"));
+		if(basicLaunch && bay.side == Bay::INSIDE && bay.launchEffects.empty() && Crew())
+			bay.launchEffects.emplace_back(basicLaunch);
 	
 	// Figure out if this ship can be carried.
 	const string &category = attributes.Category();
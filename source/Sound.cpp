@@ -41,9 +41,14 @@ bool Sound::Load(const string &path, const string &name)
 {
 	if(path.length() < 5 || path.compare(path.length() - 4, 4, ".wav"))
 		return false;
-	this->name = name;
-	
-	isLooped = path[path.length() - 5] == '~';
+	// Once this sound has been published, other threads may be reading its
+	// name, so it can only be set the first time it is loaded.
+	unsigned id = buffer.load(memory_order_acquire);
+	if(!id)
+	{
+		this->name = name;
+		isLooped = path[path.length() - 5] == '~';
+	}
 	
 	File in(path);
 	if(!in)
@@ -57,9 +62,12 @@ bool Sound::Load(const string &path, const string &name)
 	if(fread(&data[0], 1, bytes, in) != bytes)
 		return false;
 	
-	if(!buffer)
-		alGenBuffers(1, &buffer);
-	alBufferData(buffer, AL_FORMAT_MONO16, &data.front(), bytes, frequency);
+	// Sounds may be loaded in the background while the game is running, so the
+	// buffer ID must not be visible until the buffer holds the sound data.
+	if(!id)
+		alGenBuffers(1, &id);
+	alBufferData(id, AL_FORMAT_MONO16, &data.front(), bytes, frequency);
+	buffer.store(id, memory_order_release);
 	
 	return true;
 }
@@ -75,7 +83,7 @@ const string &Sound::Name() const
 
 unsigned Sound::Buffer() const
 {
-	return buffer;
+	return buffer.load(memory_order_acquire);
 }
 
 
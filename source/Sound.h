@@ -13,6 +13,7 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #ifndef SOUND_H_
 #define SOUND_H_
 
+#include <atomic>
 #include <string>
 
 
@@ -31,8 +32,10 @@ public:
 	
 private:
 	std::string name;
-	unsigned buffer = 0;
 	bool isLooped = false;
+	// Sounds are loaded in worker threads, so the buffer ID is only stored
+	// once the other fields and the buffer data are ready.
+	std::atomic<unsigned> buffer{0};
 };
 
 
@@ -13,6 +13,7 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #include "Sprite.h"
 
 #include "ImageBuffer.h"
+#include "ImageSet.h"
 #include "Preferences.h"
 #include "Screen.h"
 
@@ -23,6 +24,40 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 
 using namespace std;
 
+namespace {
+	// In low memory mode, large sprites are shrunk until neither dimension of
+	// their 1x frames is bigger than this.
+	const int LOW_MEMORY_SIZE = 512;
+	
+	// Total GPU memory saved by skipping or shrinking frames, in bytes.
+	int64_t totalReducedBytes = 0;
+	
+	int64_t TextureBytes(const ImageBuffer &buffer)
+	{
+		return static_cast<int64_t>(buffer.Width()) * buffer.Height() * buffer.Frames() * 4;
+	}
+	
+	// Until a sprite's frames have been uploaded, it is drawn with this fully
+	// transparent single-pixel texture, so that shaders never sample from an
+	// unbound (and therefore undefined) texture.
+	uint32_t Placeholder()
+	{
+		static uint32_t placeholder = 0;
+		if(!placeholder)
+		{
+			const uint32_t pixel = 0;
+			glGenTextures(1, &placeholder);
+			glBindTexture(GL_TEXTURE_2D_ARRAY, placeholder);
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+			glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, 1, 1, 1,
+				0, GL_BGRA, GL_UNSIGNED_BYTE, &pixel);
+			glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+		}
+		return placeholder;
+	}
+}
+
 
 
 Sprite::Sprite(const string &name)
@@ -39,6 +74,17 @@ const string &Sprite::Name() const
 
 
 
+// Set the dimensions of the 1x image and the number of frames. This is
+// known as soon as the images are loaded, before they are uploaded.
+void Sprite::SetSize(float width, float height, int frames)
+{
+	this->width = width;
+	this->height = height;
+	this->frames = frames;
+}
+
+
+
 // Upload the given frames. The given buffer will be cleared afterwards.
 void Sprite::AddFrames(ImageBuffer &buffer, bool is2x)
 {
@@ -46,17 +92,30 @@ void Sprite::AddFrames(ImageBuffer &buffer, bool is2x)
 	if(!buffer.Pixels())
 		return;
 	
-	// If this is the 1x image, its dimensions determine the sprite's size.
-	if(!is2x)
+	// In low memory mode, @2x frames are only uploaded if the screen is high
+	// DPI. Otherwise they would only be used when zoomed in.
+	bool lowMemory = Preferences::Has("Low memory graphics");
+	int64_t originalBytes = TextureBytes(buffer);
+	if(lowMemory && is2x && !Screen::IsHighResolution())
 	{
-		width = buffer.Width();
-		height = buffer.Height();
-		frames = buffer.Frames();
+		reducedBytes += originalBytes;
+		totalReducedBytes += originalBytes;
+		buffer.Clear();
+		return;
 	}
 	
 	// Check whether this sprite is large enough to require size reduction.
 	if(Preferences::Has("Reduce large graphics") && buffer.Width() * buffer.Height() >= 1000000)
 		buffer.ShrinkToHalfSize();
+	// In low memory mode, also cap the size of planets, landscapes, and haze.
+	if(lowMemory && ImageSet::IsReducible(name))
+	{
+		int limit = LOW_MEMORY_SIZE << is2x;
+		while(buffer.Width() > limit || buffer.Height() > limit)
+			buffer.ShrinkToHalfSize();
+	}
+	reducedBytes += originalBytes - TextureBytes(buffer);
+	totalReducedBytes += originalBytes - TextureBytes(buffer);
 	
 	// Upload the images as a single array texture.
 	glGenTextures(1, &texture[is2x]);
@@ -97,6 +156,8 @@ void Sprite::Unload()
 {
 	glDeleteTextures(2, texture);
 	texture[0] = texture[1] = 0;
+	totalReducedBytes -= reducedBytes;
+	reducedBytes = 0;
 	
 	masks.clear();
 	width = 0.f;
@@ -106,6 +167,15 @@ void Sprite::Unload()
 
 
 
+// Get the total GPU memory, in bytes, that has been saved by shrinking or
+// skipping the frames of the currently loaded sprites.
+int64_t Sprite::ReducedBytes()
+{
+	return totalReducedBytes;
+}
+
+
+
 // Get the width, in pixels, of the 1x image.
 float Sprite::Width() const
 {
@@ -147,9 +217,12 @@ uint32_t Sprite::Texture() const
 
 
 
-// Get the index of the texture for the given high DPI mode.
+// Get the index of the texture for the given high DPI mode. If this sprite has
+// not been uploaded yet, this returns a transparent placeholder texture.
 uint32_t Sprite::Texture(bool isHighDPI) const
 {
+	if(!texture[0])
+		return Placeholder();
 	return (isHighDPI && texture[1]) ? texture[1] : texture[0];
 }
 
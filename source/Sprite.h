@@ -36,6 +36,9 @@ public:
 	
 	const std::string &Name() const;
 	
+	// Set the dimensions of the 1x image and the number of frames. This is
+	// known as soon as the images are loaded, before they are uploaded.
+	void SetSize(float width, float height, int frames);
 	// Upload the given frames. The given buffer will be cleared afterwards.
 	void AddFrames(ImageBuffer &buffer, bool is2x);
 	// Move the given masks into this sprite's internal storage. The given
@@ -43,6 +46,9 @@ public:
 	void AddMasks(std::vector<Mask> &masks);
 	// Free up all textures loaded for this sprite.
 	void Unload();
+	// Get the total GPU memory, in bytes, that has been saved by shrinking or
+	// skipping the frames of the currently loaded sprites.
+	static int64_t ReducedBytes();
 	
 	// Image dimensions, in pixels.
 	float Width() const;
@@ -56,7 +62,8 @@ public:
 	Point Center() const;
 	
 	// Get the texture index, either looking it up based on the Screen's HighDPI
-	// setting or specifying it manually.
+	// setting or specifying it manually. Sprites that are still streaming in
+	// return a transparent placeholder texture.
 	uint32_t Texture() const;
 	uint32_t Texture(bool isHighDPI) const;
 	// Get the collision mask for the given frame of the animation.
@@ -68,6 +75,8 @@ private:
 	
 	uint32_t texture[2] = {0, 0};
 	std::vector<Mask> masks;
+	// Memory saved by reducing this sprite's frames, in bytes.
+	int64_t reducedBytes = 0;
 	
 	float width = 0.f;
 	float height = 0.f;
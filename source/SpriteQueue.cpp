@@ -23,6 +23,15 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 
 using namespace std;
 
+namespace {
+	// Once all the required sprites are available, limit how many background
+	// sprites are uploaded per frame so that streaming does not cause stutter.
+	const int BACKGROUND_UPLOADS = 10;
+	// While the game is still waiting for required sprites, upload up to this
+	// many sprites per call.
+	const int REQUIRED_UPLOADS = 100;
+}
+
 
 
 // Constructor, which allocates worker threads.
@@ -49,8 +58,9 @@ SpriteQueue::~SpriteQueue()
 
 
 
-// Add a sprite to load.
-void SpriteQueue::Add(const shared_ptr<ImageSet> &images)
+// Add a sprite to load. If it is not required, it will only be read once
+// all the required sprites have been read.
+void SpriteQueue::Add(const shared_ptr<ImageSet> &images, bool isRequired)
 {
 	{
 		lock_guard<mutex> lock(readMutex);
@@ -58,7 +68,19 @@ void SpriteQueue::Add(const shared_ptr<ImageSet> &images)
 		if(added < 0)
 			return;
 		
-		toRead.push(images);
+		// Sprites that affect the game itself are read before any other
+		// background sprites, because taking off has to wait for them.
+		bool isShaped = ImageSet::IsShaped(images->Name());
+		if(isRequired)
+		{
+			toRead.push_back(images);
+			++required;
+		}
+		else if(isShaped)
+			toReadLater.push_front(images);
+		else
+			toReadLater.push_back(images);
+		shaped += isShaped;
 		++added;
 	}
 	readCondition.notify_one();
@@ -66,6 +88,23 @@ void SpriteQueue::Add(const shared_ptr<ImageSet> &images)
 
 
 
+// If the sprite with the given name is still waiting in the background
+// queue, move it to the front and make it required.
+void SpriteQueue::Require(const string &name)
+{
+	lock_guard<mutex> lock(readMutex);
+	for(auto it = toReadLater.begin(); it != toReadLater.end(); ++it)
+		if((*it)->Name() == name)
+		{
+			toRead.push_back(*it);
+			toReadLater.erase(it);
+			++required;
+			return;
+		}
+}
+
+
+
 // Unload the texture for the given sprite (to free up memory).
 void SpriteQueue::Unload(const string &name)
 {
@@ -75,7 +114,8 @@ void SpriteQueue::Unload(const string &name)
 
 
 
-// Find out our percent completion.
+// Upload more images and find out the percent completion of the required
+// sprites. Background sprites continue to be uploaded after this is 100%.
 double SpriteQueue::Progress()
 {
 	unique_lock<mutex> lock(loadMutex);
@@ -84,7 +124,8 @@ double SpriteQueue::Progress()
 
 
 
-// Finish loading.
+// Finish loading all the required sprites, and wait until the size and
+// collision masks of every sprite that affects the game are known.
 void SpriteQueue::Finish()
 {
 	// Loop until done loading.
@@ -93,7 +134,13 @@ void SpriteQueue::Finish()
 		unique_lock<mutex> lock(loadMutex);
 		
 		// Load whatever is already queued up for loading.
-		if(DoLoad(lock) == 1.)
+		bool isDone = (DoLoad(lock) == 1.);
+		{
+			// The values of "added" and "shaped" are protected by readMutex.
+			lock_guard<mutex> readLock(readMutex);
+			isDone &= (added < 0 || shapedCompleted >= shaped);
+		}
+		if(isDone)
 			break;
 		
 		// We still have sprites to upload, but none of them have been read from
@@ -116,12 +163,15 @@ void SpriteQueue::operator()()
 			// "added" to -1.
 			if(added < 0)
 				return;
-			if(toRead.empty())
+			if(toRead.empty() && toReadLater.empty())
 				break;
 			
-			// Extract the one item we should work on reading right now.
-			shared_ptr<ImageSet> imageSet = toRead.front();
-			toRead.pop();
+			// Extract the one item we should work on reading right now. Only
+			// start on the background sprites once no required ones are left.
+			bool isRequired = !toRead.empty();
+			deque<shared_ptr<ImageSet>> &source = (isRequired ? toRead : toReadLater);
+			shared_ptr<ImageSet> imageSet = source.front();
+			source.pop_front();
 			
 			// It's now safe to add to the lists.
 			lock.unlock();
@@ -132,7 +182,7 @@ void SpriteQueue::operator()()
 			{
 				// The texture must be uploaded to OpenGL in the main thread.
 				unique_lock<mutex> lock(loadMutex);
-				toLoad.push(imageSet);
+				toLoad.emplace(imageSet, isRequired);
 			}
 			loadCondition.notify_one();
 			
@@ -157,12 +207,32 @@ double SpriteQueue::DoLoad(unique_lock<mutex> &lock)
 		lock.lock();
 	}
 	
-	for(int i = 0; !toLoad.empty() && i < 100; ++i)
+	// Setting a sprite's size and masks is cheap, so do that for every sprite
+	// that has been read, even ones that will not be uploaded for a while.
+	while(!toLoad.empty())
 	{
-		// Extract the one item we should work on uploading right now.
-		shared_ptr<ImageSet> imageSet = toLoad.front();
+		toUpload.push(toLoad.front());
+		shared_ptr<ImageSet> imageSet = toLoad.front().first;
 		toLoad.pop();
 		
+		lock.unlock();
+		imageSet->Shape(SpriteSet::Modify(imageSet->Name()));
+		lock.lock();
+		shapedCompleted += ImageSet::IsShaped(imageSet->Name());
+	}
+	
+	// The values of "added" and "required" are protected by readMutex.
+	unique_lock<mutex> readLock(readMutex);
+	int limit = (requiredCompleted < required ? REQUIRED_UPLOADS : BACKGROUND_UPLOADS);
+	readLock.unlock();
+	
+	for(int i = 0; !toUpload.empty() && i < limit; ++i)
+	{
+		// Extract the one item we should work on uploading right now.
+		shared_ptr<ImageSet> imageSet = toUpload.front().first;
+		bool isRequired = toUpload.front().second;
+		toUpload.pop();
+		
 		// It's now safe to modify the lists.
 		lock.unlock();
 		
@@ -170,13 +240,14 @@ double SpriteQueue::DoLoad(unique_lock<mutex> &lock)
 		
 		lock.lock();
 		++completed;
+		requiredCompleted += isRequired;
 	}
 	
-	// Wait until we have completed loading of as many sprites as we have added.
-	// The value of "added" is protected by readMutex.
-	unique_lock<mutex> readLock(readMutex);
+	// Only the required sprites must be uploaded before the game can continue.
+	// Anything else keeps loading in the background.
+	readLock.lock();
 	// Special cases: we're bailing out, or we are done.
-	if(added <= 0 || added == completed)
+	if(added <= 0 || requiredCompleted >= required)
 		return 1.;
-	return static_cast<double>(completed) / static_cast<double>(added);
+	return static_cast<double>(requiredCompleted) / static_cast<double>(required);
 }
@@ -14,12 +14,13 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #define SPRITE_QUEUE_H_
 
 #include <condition_variable>
-#include <map>
+#include <deque>
 #include <memory>
 #include <mutex>
 #include <queue>
 #include <string>
 #include <thread>
+#include <utility>
 #include <vector>
 
 class ImageBuffer;
@@ -30,19 +31,30 @@ class Sprite;
 
 
 // Class for queuing up a list of sprites to be loaded from the disk, with a set of
-// worker threads that begins loading them as soon as they are added.
+// worker threads that begins loading them as soon as they are added. Sprites
+// that are "required" are read first, and the game only needs to wait for those;
+// everything else streams in afterwards, a few uploads per frame. A sprite's
+// size and collision masks are set as soon as it has been read, so sprites that
+// affect the game itself (e.g. ships) only need to be read, not uploaded, before
+// the player can take off.
 class SpriteQueue {
 public:
 	SpriteQueue();
 	~SpriteQueue();
 	
-	// Add a sprite to load.
-	void Add(const std::shared_ptr<ImageSet> &images);
+	// Add a sprite to load. If it is not required, it will only be read once
+	// all the required sprites have been read.
+	void Add(const std::shared_ptr<ImageSet> &images, bool isRequired = true);
+	// If the sprite with the given name is still waiting in the background
+	// queue, move it to the front and make it required.
+	void Require(const std::string &name);
 	// Unload the texture for the given sprite (to free up memory).
 	void Unload(const std::string &name);
-	// Upload more iamges and find out our percent completion.
+	// Upload more images and find out the percent completion of the required
+	// sprites. Background sprites continue to be uploaded after this is 100%.
 	double Progress();
-	// Finish loading.
+	// Finish loading all the required sprites, and wait until the size and
+	// collision masks of every sprite that affects the game are known.
 	void Finish();
 	
 	// Thread entry point.
@@ -54,17 +66,26 @@ private:
 	
 	
 private:
-	// These are the image sets that need to be loaded from disk.
-	std::queue<std::shared_ptr<ImageSet>> toRead;
+	// These are the image sets that need to be loaded from disk. Required ones
+	// are always read before any in the background queue.
+	std::deque<std::shared_ptr<ImageSet>> toRead;
+	std::deque<std::shared_ptr<ImageSet>> toReadLater;
 	std::mutex readMutex;
 	std::condition_variable readCondition;
 	int added = 0;
+	int required = 0;
+	int shaped = 0;
 	
-	// These image sets have been loaded from disk but have not been uplodaed.
-	std::queue<std::shared_ptr<ImageSet>> toLoad;
+	// These image sets have been loaded from disk, but their sprites do not
+	// know their size yet. Each one is tagged with whether it was required.
+	std::queue<std::pair<std::shared_ptr<ImageSet>, bool>> toLoad;
+	// These image sets are waiting to be uploaded.
+	std::queue<std::pair<std::shared_ptr<ImageSet>, bool>> toUpload;
 	std::mutex loadMutex;
 	std::condition_variable loadCondition;
 	int completed = 0;
+	int requiredCompleted = 0;
+	int shapedCompleted = 0;
 	
 	// These sprites must be unloaded to reclaim GPU memory.
 	std::queue<std::string> toUnload;
@@ -18,6 +18,7 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #include "pi.h"
 #include "Point.h"
 #include "Preferences.h"
+#include "Profiler.h"
 #include "Random.h"
 #include "Screen.h"
 #include "Sprite.h"
@@ -90,6 +91,8 @@ void StarField::SetHaze(const Sprite *sprite)
 
 void StarField::Draw(const Point &pos, const Point &vel, double zoom) const
 {
+	Profiler::Timer timer(Profiler::STARFIELD);
+	
 	glUseProgram(shader.Object());
 	glBindVertexArray(vao);
 	
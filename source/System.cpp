@@ -37,6 +37,48 @@ namespace {
 	const double VOLUME = 2000.;
 	// Above this supply amount, price differences taper off:
 	const double LIMIT = 20000.;
+	
+	// All the indexed systems, and their links and neighbors in "compressed
+	// sparse row" form: the links of system i are the entries in linkIndices
+	// from linkOffsets[i] up to linkOffsets[i + 1], and likewise for neighbors.
+	vector<const System *> indexed;
+	vector<int> linkOffsets(1, 0);
+	vector<int> linkIndices;
+	vector<int> neighborOffsets(1, 0);
+	vector<int> neighborIndices;
+	
+	// The economy of every indexed system, in flat arrays with one entry per
+	// commodity: the entries for system i start at i * commodityCount. The
+	// weight of a commodity that a system does not trade is zero, so the daily
+	// update can handle every entry in the same way, without any branches.
+	map<string, int> commodityIndex;
+	size_t commodityCount = 0;
+	vector<int> bases;
+	vector<int> prices;
+	vector<double> weights;
+	vector<double> supplies;
+	vector<double> exports;
+	// Each system exports an equal share of its goods to each linked system.
+	vector<double> shares;
+	
+	
+	
+	// Get the entry in the economy arrays for the given system and commodity,
+	// or -1 if there is none.
+	int Entry(int system, const string &commodity)
+	{
+		auto it = commodityIndex.find(commodity);
+		if(system < 0 || static_cast<size_t>(system) >= shares.size() || it == commodityIndex.end())
+			return -1;
+		return system * commodityCount + it->second;
+	}
+	
+	
+	
+	void UpdatePrice(size_t entry)
+	{
+		prices[entry] = bases[entry] + static_cast<int>(-100. * erf(supplies[entry] / LIMIT));
+	}
 }
 
 const double System::NEIGHBOR_DISTANCE = 100.;
@@ -106,6 +148,27 @@ int System::FleetProbability::Period() const
 
 
 
+System::IndexRange::IndexRange(const int *first, const int *last)
+	: first(first), last(last)
+{
+}
+
+
+
+const int *System::IndexRange::begin() const
+{
+	return first;
+}
+
+
+
+const int *System::IndexRange::end() const
+{
+	return last;
+}
+
+
+
 // Load a system's description.
 void System::Load(const DataNode &node, Set<Planet> &planets)
 {
@@ -265,7 +328,7 @@ void System::Load(const DataNode &node, Set<Planet> &planets)
 		else if(key == "haze")
 			haze = SpriteSet::Get(value);
 		else if(key == "trade" && child.Size() >= 3)
-			trade[value].SetBase(child.Value(valueIndex + 1));
+			trade[value] = child.Value(valueIndex + 1);
 		else if(key == "object")
 			LoadObject(child, planets);
 		else
@@ -356,6 +419,186 @@ void System::UpdateNeighbors(const Set<System> &systems)
 
 
 
+// Once the neighbors of every system are known, give each system a dense
+// index and copy all their links and neighbors into flat arrays, so code
+// that searches the whole star map can use arrays instead of following
+// pointers. This must be done again whenever the links change.
+void System::UpdateIndices(Set<System> &systems)
+{
+	// Systems keep the indices that they were already given, but reverting to
+	// the default game data deletes any systems that events created, so only
+	// systems that are still in the set can keep their slots. The pointers to
+	// the others may no longer be valid, so they are never dereferenced here.
+	vector<const System *> live(indexed.size(), nullptr);
+	vector<System *> added;
+	for(auto &it : systems)
+	{
+		int index = it.second.index;
+		if(index >= 0 && static_cast<size_t>(index) < indexed.size() && indexed[index] == &it.second)
+			live[index] = &it.second;
+		else
+		{
+			it.second.index = -1;
+			added.push_back(&it.second);
+		}
+	}
+	// Any new systems fill in the slots that deleted systems left empty. The
+	// economy of those slots starts over from scratch.
+	vector<bool> isKept(live.size());
+	for(size_t i = 0; i < live.size(); ++i)
+		isKept[i] = (live[i] != nullptr);
+	size_t slot = 0;
+	for(System *system : added)
+	{
+		while(slot < live.size() && live[slot])
+			++slot;
+		system->index = slot;
+		if(slot == live.size())
+			live.push_back(system);
+		else
+			live[slot] = system;
+	}
+	indexed.swap(live);
+	
+	linkOffsets.assign(1, 0);
+	linkIndices.clear();
+	neighborOffsets.assign(1, 0);
+	neighborIndices.clear();
+	for(const System *system : indexed)
+	{
+		if(system)
+		{
+			for(const System *link : system->links)
+				linkIndices.push_back(link->index);
+			for(const System *neighbor : system->neighbors)
+				neighborIndices.push_back(neighbor->index);
+		}
+		linkOffsets.push_back(linkIndices.size());
+		neighborOffsets.push_back(neighborIndices.size());
+	}
+	
+	// Lay out the economy arrays again, keeping the supply of any commodity
+	// that was already being traded.
+	map<string, int> oldIndex;
+	oldIndex.swap(commodityIndex);
+	size_t oldCount = commodityCount;
+	vector<double> oldSupplies;
+	oldSupplies.swap(supplies);
+	
+	for(const Trade::Commodity &commodity : GameData::Commodities())
+		commodityIndex.emplace(commodity.name, commodityIndex.size());
+	commodityCount = commodityIndex.size();
+	size_t size = indexed.size() * commodityCount;
+	bases.assign(size, 0);
+	prices.assign(size, 0);
+	weights.assign(size, 0.);
+	supplies.assign(size, 0.);
+	exports.assign(size, 0.);
+	shares.assign(indexed.size(), 0.);
+	for(size_t i = 0; i < indexed.size(); ++i)
+	{
+		if(!indexed[i])
+			continue;
+		
+		const System &system = *indexed[i];
+		if(!system.links.empty())
+			shares[i] = 1. / system.links.size();
+		for(const auto &it : system.trade)
+		{
+			auto cit = commodityIndex.find(it.first);
+			if(cit == commodityIndex.end())
+				continue;
+			
+			size_t entry = i * commodityCount + cit->second;
+			bases[entry] = it.second;
+			weights[entry] = 1.;
+			auto oit = oldIndex.find(it.first);
+			if(i < isKept.size() && isKept[i] && oit != oldIndex.end())
+				supplies[entry] = oldSupplies[i * oldCount + oit->second];
+			UpdatePrice(entry);
+		}
+	}
+}
+
+
+
+// Update the economy of every indexed system for the given number of days.
+// Each day, each system produces goods and exports some of them to the
+// systems it is linked to. Doing many days at once is faster than doing
+// them one at a time, because the prices are only updated at the end.
+void System::StepEconomy(int days)
+{
+	size_t size = supplies.size();
+	vector<double> next(size);
+	for(int day = 0; day < days; ++day)
+	{
+		// Each system gets an equal share of the exports of each system it is
+		// linked to. This is a sparse matrix product, with one row for each
+		// system. The new supplies are not stored until all the rows are done,
+		// so the order the systems are in does not matter.
+		for(size_t i = 0; i < shares.size(); ++i)
+		{
+			double *row = next.data() + i * commodityCount;
+			fill(row, row + commodityCount, 0.);
+			for(int l = linkOffsets[i]; l < linkOffsets[i + 1]; ++l)
+			{
+				int link = linkIndices[l];
+				const double *source = supplies.data() + link * commodityCount;
+				double share = shares[link];
+				for(size_t c = 0; c < commodityCount; ++c)
+					row[c] += source[c] * share;
+			}
+		}
+		// Each system keeps some of its goods and exports some of them, and can
+		// only import the commodities that it trades.
+		for(size_t i = 0; i < size; ++i)
+			next[i] = KEEP * supplies[i] + EXPORT * next[i] * weights[i];
+		// It also produces a random amount of each commodity that it trades.
+		for(size_t i = 0; i < size; ++i)
+			if(weights[i])
+				next[i] += Random::Normal() * VOLUME;
+		
+		if(day == days - 1)
+			for(size_t i = 0; i < size; ++i)
+				exports[i] = EXPORT * supplies[i];
+		supplies.swap(next);
+	}
+	for(size_t i = 0; i < size; ++i)
+		UpdatePrice(i);
+}
+
+
+
+// Set the supply of every commodity in every system back to zero.
+void System::ResetEconomy()
+{
+	for(size_t i = 0; i < supplies.size(); ++i)
+	{
+		supplies[i] = 0.;
+		exports[i] = 0.;
+		UpdatePrice(i);
+	}
+}
+
+
+
+// Get the number of systems that have an index.
+int System::IndexCount()
+{
+	return indexed.size();
+}
+
+
+
+// Get the system with the given index. This is null if the system that had
+// that index has been deleted.
+const System *System::FromIndex(int index)
+{
+	return (index >= 0 && static_cast<size_t>(index) < indexed.size()) ? indexed[index] : nullptr;
+}
+
+
+
 // Modify a system's links.
 void System::Link(System *other)
 {
@@ -443,6 +686,36 @@ const set<const System *> &System::Neighbors() const
 
 
 
+// Get this system's index, or -1 if it was created after the indices were
+// last updated.
+int System::Index() const
+{
+	return index;
+}
+
+
+
+// Get the indices of the linked and neighboring systems.
+System::IndexRange System::LinkIndices() const
+{
+	if(index < 0)
+		return IndexRange(nullptr, nullptr);
+	return IndexRange(linkIndices.data() + linkOffsets[index],
+		linkIndices.data() + linkOffsets[index + 1]);
+}
+
+
+
+System::IndexRange System::NeighborIndices() const
+{
+	if(index < 0)
+		return IndexRange(nullptr, nullptr);
+	return IndexRange(neighborIndices.data() + neighborOffsets[index],
+		neighborIndices.data() + neighborOffsets[index + 1]);
+}
+
+
+
 // Move the stellar objects to their positions on the given date.
 void System::SetDate(const Date &date)
 {
@@ -593,8 +866,8 @@ const Sprite *System::Haze() const
 // Get the price of the given commodity in this system.
 int System::Trade(const string &commodity) const
 {
-	auto it = trade.find(commodity);
-	return (it == trade.end()) ? 0 : it->second.price;
+	int entry = Entry(index, commodity);
+	return (entry < 0) ? 0 : prices[entry];
 }
 
 
@@ -606,44 +879,30 @@ bool System::HasTrade() const
 
 
 
-// Update the economy.
-void System::StepEconomy()
-{
-	for(auto &it : trade)
-	{
-		it.second.exports = EXPORT * it.second.supply;
-		it.second.supply *= KEEP;
-		it.second.supply += Random::Normal() * VOLUME;
-		it.second.Update();
-	}
-}
-
-
-
 void System::SetSupply(const string &commodity, double tons)
 {
-	auto it = trade.find(commodity);
-	if(it == trade.end())
+	int entry = Entry(index, commodity);
+	if(entry < 0 || !weights[entry])
 		return;
 	
-	it->second.supply = tons;
-	it->second.Update();
+	supplies[entry] = tons;
+	UpdatePrice(entry);
 }
 
 
 
 double System::Supply(const string &commodity) const
 {
-	auto it = trade.find(commodity);
-	return (it == trade.end()) ? 0 : it->second.supply;
+	int entry = Entry(index, commodity);
+	return (entry < 0) ? 0 : supplies[entry];
 }
 
 
 
 double System::Exports(const string &commodity) const
 {
-	auto it = trade.find(commodity);
-	return (it == trade.end()) ? 0 : it->second.exports;
+	int entry = Entry(index, commodity);
+	return (entry < 0) ? 0 : exports[entry];
 }
 
 
@@ -708,18 +967,3 @@ void System::LoadObject(const DataNode &node, Set<Planet> &planets, int parent)
 			child.PrintTrace("Skipping unrecognized attribute:");
 	}
 }
-
-
-
-void System::Price::SetBase(int base)
-{
-	this->base = base;
-	this->price = base;
-}
-
-
-
-void System::Price::Update()
-{
-	price = base + static_cast<int>(-100. * erf(supply / LIMIT));
-}
@@ -17,6 +17,7 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #include "Set.h"
 #include "StellarObject.h"
 
+#include <map>
 #include <set>
 #include <string>
 #include <vector>
@@ -70,6 +71,41 @@ public:
 		int period;
 	};
 	
+	// A range of system indices, within one of the flat arrays that hold the
+	// links and neighbors of every system in the galaxy.
+	class IndexRange {
+	public:
+		IndexRange(const int *first, const int *last);
+		
+		const int *begin() const;
+		const int *end() const;
+		
+	private:
+		const int *first;
+		const int *last;
+	};
+	
+	
+public:
+	// Once the neighbors of every system are known, give each system a dense
+	// index and copy all their links and neighbors into flat arrays, so code
+	// that searches the whole star map can use arrays instead of following
+	// pointers. This must be done again whenever the links change.
+	static void UpdateIndices(Set<System> &systems);
+	// Get the number of systems that have an index.
+	static int IndexCount();
+	// Get the system with the given index. This is null if the system that had
+	// that index has been deleted.
+	static const System *FromIndex(int index);
+	
+	// Update the economy of every indexed system for the given number of days.
+	// Each day, each system produces goods and exports some of them to the
+	// systems it is linked to. Doing many days at once is faster than doing
+	// them one at a time, because the prices are only updated at the end.
+	static void StepEconomy(int days = 1);
+	// Set the supply of every commodity in every system back to zero.
+	static void ResetEconomy();
+	
 	
 public:
 	// Load a system's description.
@@ -99,6 +135,12 @@ public:
 	// direct hyperspace link to them. This is also the set of systems that you
 	// can travel to from here via the jump drive.
 	const std::set<const System *> &Neighbors() const;
+	// Get this system's index, or -1 if it was created after the indices were
+	// last updated.
+	int Index() const;
+	// Get the indices of the linked and neighboring systems.
+	IndexRange LinkIndices() const;
+	IndexRange NeighborIndices() const;
 	
 	// Move the stellar objects to their positions on the given date.
 	void SetDate(const Date &date);
@@ -130,8 +172,6 @@ public:
 	// Get the price of the given commodity in this system.
 	int Trade(const std::string &commodity) const;
 	bool HasTrade() const;
-	// Update the economy. Returns the amount of trade goods this system exports.
-	void StepEconomy();
 	void SetSupply(const std::string &commodity, double tons);
 	double Supply(const std::string &commodity) const;
 	double Exports(const std::string &commodity) const;
@@ -147,19 +187,6 @@ private:
 	void LoadObject(const DataNode &node, Set<Planet> &planets, int parent = -1);
 	
 	
-private:
-	class Price {
-	public:
-		void SetBase(int base);
-		void Update();
-		
-		int base = 0;
-		int price = 0;
-		double supply = 0.;
-		double exports = 0.;
-	};
-	
-	
 private:
 	// Name and position (within the star map) of this system.
 	std::string name;
@@ -170,6 +197,7 @@ private:
 	// Hyperspace links to other systems.
 	std::set<const System *> links;
 	std::set<const System *> neighbors;
+	int index = -1;
 	
 	// Stellar objects, listed in such an order that an object's parents are
 	// guaranteed to appear before it (so that if we traverse the vector in
@@ -184,8 +212,9 @@ private:
 	double solarPower = 0.;
 	double solarWind = 0.;
 	
-	// Commodity prices.
-	std::map<std::string, Price> trade;
+	// The base price of each commodity. The supply, exports, and current
+	// price of each one are stored with those of all the other systems.
+	std::map<std::string, int> trade;
 	
 	// Attributes, for use in location filters.
 	std::set<std::string> attributes;
@@ -18,7 +18,9 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #include "ConversationPanel.h"
 #include "DataFile.h"
 #include "DataNode.h"
+#include "DataWriter.h"
 #include "Dialog.h"
+#include "Engine.h"
 #include "Files.h"
 #include "Font.h"
 #include "FrameTimer.h"
@@ -28,6 +30,8 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #include "Panel.h"
 #include "PlayerInfo.h"
 #include "Preferences.h"
+#include "Profiler.h"
+#include "SaveQueue.h"
 #include "Screen.h"
 #include "SpriteSet.h"
 #include "SpriteShader.h"
@@ -36,6 +40,8 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #include "gl_header.h"
 #include <SDL2/SDL.h>
 
+#include <algorithm>
+#include <chrono>
 #include <cstring>
 #include <iostream>
 #include <map>
@@ -53,9 +59,12 @@ void PrintHelp();
 void PrintVersion();
 void SetIcon(SDL_Window *window);
 void AdjustViewport(SDL_Window *window);
+bool SetVSync(bool shouldSync);
+int RefreshRate(SDL_Window *window);
 int DoError(string message, SDL_Window *window = nullptr, SDL_GLContext context = nullptr);
 void Cleanup(SDL_Window *window, SDL_GLContext context);
 Conversation LoadConversation();
+void ExportSave(const string &path);
 #ifdef _WIN32
 void InitConsole();
 #endif
@@ -71,6 +80,7 @@ int main(int argc, char *argv[])
 	Conversation conversation;
 	bool debugMode = false;
 	bool loadOnly = false;
+	bool isSilent = false;
 	for(const char *const *it = argv + 1; *it; ++it)
 	{
 		string arg = *it;
@@ -90,6 +100,13 @@ int main(int argc, char *argv[])
 			debugMode = true;
 		else if(arg == "-p" || arg == "--parse-save")
 			loadOnly = true;
+		else if(arg == "-n" || arg == "--no-sound")
+			isSilent = true;
+		else if((arg == "-e" || arg == "--export-save") && *(it + 1))
+		{
+			ExportSave(*++it);
+			return 0;
+		}
 	}
 	PlayerInfo player;
 	
@@ -108,7 +125,7 @@ int main(int argc, char *argv[])
 		
 		SDL_Init(SDL_INIT_VIDEO);
 		
-		Audio::Init(GameData::Sources());
+		Audio::Init(GameData::Sources(), isSilent);
 		
 		// On Windows, make sure that the sleep timer has at least 1 ms resolution
 		// to avoid irregular frame rates.
@@ -166,7 +183,8 @@ int main(int argc, char *argv[])
 		if(SDL_GL_MakeCurrent(window, context))
 			return DoError("Unable to set the current OpenGL context!", window, context);
 		
-		SDL_GL_SetSwapInterval(1);
+		bool useVSync = Preferences::Has("Vertical sync");
+		bool isVSync = SetVSync(useVSync);
 		
 		// Initialize GLEW.
 #ifndef __APPLE__
@@ -251,17 +269,26 @@ int main(int argc, char *argv[])
 		
 		bool showCursor = true;
 		int cursorTime = 0;
+		// The game always advances in fixed steps, normally 60 per second, no
+		// matter how often the screen is refreshed. This is how many steps of
+		// real time have passed that the game has not caught up to yet.
 		int frameRate = 60;
-		FrameTimer timer(frameRate);
+		double steps = 0.;
+		chrono::steady_clock::time_point lastFrame = chrono::steady_clock::now();
+		// If vertical sync is off or not available, this timer paces the frames
+		// to the refresh rate of the display instead.
+		FrameTimer timer(RefreshRate(window));
+		// When fast forwarding, the game runs several times faster than normal.
+		// The speed adapts so that the steps take up a reasonable fraction of
+		// the time between frames.
+		int speed = 3;
+		double stepLoad = 0.;
+		int speedTimeout = 0;
 		bool isPaused = false;
-		// If fast forwarding, keep track of whether the current frame should be drawn.
-		int skipFrame = 0;
 		// Limit how quickly fullscreen mode can be toggled.
 		int toggleTimeout = 0;
 		while(!menuPanels.IsDone())
 		{
-			if(toggleTimeout)
-				--toggleTimeout;
 			// Handle any events that occurred in this frame.
 			SDL_Event event;
 			while(SDL_PollEvent(&event))
@@ -296,6 +323,8 @@ int main(int argc, char *argv[])
 					AdjustViewport(window);
 					if(!isFullscreen)
 						SDL_GetWindowSize(window, &windowWidth, &windowHeight);
+					// The window may now be on a different display.
+					timer.SetFrameRate(RefreshRate(window));
 				}
 				else if(event.type == SDL_KEYDOWN && !toggleTimeout
 						&& (Command(event.key.keysym.sym).Has(Command::FULLSCREEN)
@@ -321,10 +350,70 @@ int main(int argc, char *argv[])
 			SDL_Keymod mod = SDL_GetModState();
 			Font::ShowUnderlines(mod & KMOD_ALT);
 			
+			bool inFlight = (menuPanels.IsEmpty() && gamePanels.Root() == gamePanels.Top());
+			
+			// Caps lock slows the game down in debug mode, but speeds it up in
+			// normal mode.
+			bool slowMotion = ((mod & KMOD_CAPS) && inFlight && debugMode);
+			bool fastForward = ((mod & KMOD_CAPS) && inFlight && !debugMode);
+			int multiplier = (fastForward ? speed : 1);
+			
+			// Figure out how many steps to run before drawing this frame. If the
+			// game cannot keep up, it slows down instead of trying to catch up.
+			chrono::steady_clock::time_point now = chrono::steady_clock::now();
+			double interval = chrono::duration<double>(now - lastFrame).count();
+			steps += interval * frameRate * multiplier;
+			steps = min(steps, 3. * multiplier);
+			lastFrame = now;
+			// In pipelined mode, if the calculation thread is still busy with the
+			// last step, draw the most recent frame instead of waiting for it,
+			// unless that would put the game more than one step behind.
+			bool isPipelined = Preferences::Has("Pipelined simulation");
+			for( ; steps >= 1.; steps -= 1.)
+			{
+				if(isPipelined && steps < 2. && Engine::IsBusy())
+					break;
+				
+				if(toggleTimeout)
+					--toggleTimeout;
+				++cursorTime;
+				
+				// Only the last two steps before drawing can end up on the screen,
+				// so there is no need to figure out what to draw for the others.
+				// In pipelined mode, the last step may be skipped by the check
+				// above, so one more step must be drawn just in case.
+				Engine::SetDrawing(steps < (isPipelined ? 4. : 3.));
+				// Tell all the panels to step forward.
+				((!isPaused && menuPanels.IsEmpty()) ? gamePanels : menuPanels).StepAll();
+				
+				// Slowing down eases in and out over a couple of steps.
+				if(slowMotion)
+					frameRate = max(frameRate - 5, 10);
+				else
+					frameRate = min(frameRate + 5, 60);
+			}
+			Engine::SetDrawing(true);
+			
+			// Speed up the fast forwarding if the steps take less than a quarter
+			// of each frame, and slow it down if they take more than half.
+			if(fastForward)
+			{
+				double busy = chrono::duration<double>(chrono::steady_clock::now() - now).count();
+				stepLoad = .9 * stepLoad + .1 * busy / max(interval, .001);
+				if(++speedTimeout >= 30)
+				{
+					speedTimeout = 0;
+					if(stepLoad > .5)
+						speed = max(speed - 1, 2);
+					else if(stepLoad < .25)
+						speed = min(speed + 1, 10);
+				}
+			}
+			// If the game is not advancing, it must not be drawn between steps.
+			Engine::SetInterpolation((isPaused || !menuPanels.IsEmpty()) ? 1. : steps);
+			
 			// In fullscreen mode, hide the cursor if inactive for ten seconds,
 			// but only if the player is flying around in the main view.
-			bool inFlight = (menuPanels.IsEmpty() && gamePanels.Root() == gamePanels.Top());
-			++cursorTime;
 			bool shouldShowCursor = (!isFullscreen || cursorTime < 600 || !inFlight);
 			if(shouldShowCursor != showCursor)
 			{
@@ -332,50 +421,42 @@ int main(int argc, char *argv[])
 				SDL_ShowCursor(showCursor);
 			}
 			
-			// Tell all the panels to step forward, then draw them.
-			((!isPaused && menuPanels.IsEmpty()) ? gamePanels : menuPanels).StepAll();
-			
-			// Caps lock slows the frame rate in debug mode, but raises it in
-			// normal mode. Slowing eases in and out over a couple of frames.
-			bool fastForward = false;
-			if((mod & KMOD_CAPS) && inFlight)
+			// Vertical sync can be turned on or off in the preferences.
+			if(Preferences::Has("Vertical sync") != useVSync)
 			{
-				if(debugMode)
-				{
-					if(frameRate > 10)
-					{
-						frameRate = max(frameRate - 5, 10);
-						timer.SetFrameRate(frameRate);
-					}
-				}
-				else
-				{
-					fastForward = true;
-					skipFrame = (skipFrame + 1) % 3;
-					if(skipFrame)
-						continue;
-				}
-			}
-			else if(frameRate < 60)
-			{
-				frameRate = min(frameRate + 5, 60);
-				timer.SetFrameRate(frameRate);
+				useVSync = !useVSync;
+				isVSync = SetVSync(useVSync);
 			}
 			
+			Profiler::BeginFrame();
+			Profiler::SetQueueDepth(static_cast<int>(steps));
 			Audio::Step();
+			// Upload some of the sprites that are streaming in, no matter which
+			// panel is open.
+			GameData::Progress();
 			// Events in this frame may have cleared out the menu, in which case
 			// we should draw the game panels instead:
-			(menuPanels.IsEmpty() ? gamePanels : menuPanels).DrawAll();
+			{
+				Profiler::Timer panelTimer(Profiler::PANELS);
+				(menuPanels.IsEmpty() ? gamePanels : menuPanels).DrawAll();
+			}
 			if(fastForward)
 				SpriteShader::Draw(SpriteSet::Get("ui/fast forward"), Screen::TopLeft() + Point(10., 10.));
+			Profiler::Draw();
+			Profiler::EndFrame();
 			
-			SDL_GL_SwapWindow(window);
-			timer.Wait();
+			{
+				Profiler::Timer swapTimer(Profiler::SWAP);
+				SDL_GL_SwapWindow(window);
+			}
+			if(!isVSync)
+				timer.Wait();
 		}
 		
 		// If you quit while landed on a planet, save the game - if you did anything.
 		if(player.GetPlanet() && gamePanels.CanSave())
 			player.Save();
+		SaveQueue::Compact();
 		
 		// Remember the window state.
 		bool isMaximized = (SDL_GetWindowFlags(window) & SDL_WINDOW_MAXIMIZED);
@@ -406,11 +487,14 @@ void PrintHelp()
 	cerr << "    -v, --version: print version information." << endl;
 	cerr << "    -s, --ships: print table of ship statistics, then exit." << endl;
 	cerr << "    -w, --weapons: print table of weapon statistics, then exit." << endl;
+	cerr << "    -a, --advance-economy <days>: time advancing the economy one day at a time and all at once, then exit." << endl;
 	cerr << "    -t, --talk: read and display a conversation from STDIN." << endl;
 	cerr << "    -r, --resources <path>: load resources from given directory." << endl;
 	cerr << "    -c, --config <path>: save user's files to given directory." << endl;
 	cerr << "    -d, --debug: turn on debugging features (e.g. Caps Lock slows down instead of speeds up)." << endl;
 	cerr << "    -p, --parse-save: load the most recent saved game and inspect it for content errors" << endl;
+	cerr << "    -n, --no-sound: mix all audio into a silent device instead of playing it (for profiling)." << endl;
+	cerr << "    -e, --export-save <path>: print the given saved game in the text format, then exit." << endl;
 	cerr << endl;
 	cerr << "Report bugs to: <https://github.com/endless-sky/endless-sky/issues>" << endl;
 	cerr << "Home page: <https://endless-sky.github.io>" << endl;
@@ -518,6 +602,31 @@ int DoError(string message, SDL_Window *window, SDL_GLContext context)
 
 
 
+// Turn vertical sync on or off. Returns true if buffer swaps are now synced
+// to the display's refresh rate.
+bool SetVSync(bool shouldSync)
+{
+	if(shouldSync && !SDL_GL_SetSwapInterval(1))
+		return true;
+	
+	SDL_GL_SetSwapInterval(0);
+	return false;
+}
+
+
+
+// Get the refresh rate of the display the window is on, or 60 Hz if that is
+// not known.
+int RefreshRate(SDL_Window *window)
+{
+	SDL_DisplayMode mode;
+	if(!SDL_GetWindowDisplayMode(window, &mode) && mode.refresh_rate > 0)
+		return mode.refresh_rate;
+	return 60;
+}
+
+
+
 void Cleanup(SDL_Window *window, SDL_GLContext context)
 {
 	// Make sure the cursor is visible.
@@ -570,6 +679,21 @@ Conversation LoadConversation()
 
 
 
+// Print the given saved game (in either the text or the binary format) to
+// STDOUT in the text format.
+void ExportSave(const string &path)
+{
+	// Include the most recent journal entry, if the saved game has one.
+	DataFile file;
+	SaveQueue::Read(path, file);
+	DataWriter out;
+	for(const DataNode &node : file)
+		out.Write(node);
+	cout << out.GetString();
+}
+
+
+
 #ifdef _WIN32
 void InitConsole()
 {